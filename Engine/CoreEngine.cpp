@@ -15,13 +15,19 @@
 */
 
 #include "CoreEngine.hpp"
+#include "profiling/Profiler.hpp"
 #include "window.hpp"
 
 #include <GLFW/glfw3.h>
+#include <algorithm>
 #include <bits/chrono.h>
 #include <chrono>
+#include <cstdio>
 #include <memory>
 #include <ratio>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 #include <spdlog/spdlog.h>
 
 typedef std::chrono::high_resolution_clock Clock;
@@ -33,16 +39,32 @@ constexpr float toSeconds(std::chrono::nanoseconds d)
 }
 
 CoreEngine::CoreEngine(Window& window, float fixedFPS, VkPhysicalDeviceFeatures targetFeatures) : m_window(window),
+                                                                                                  m_updateSystems{ m_scene, m_jobs },
+                                                                                                  m_renderSystems{ m_scene, m_jobs },
                                                                                                   m_device{ window.context(), window.surface(), targetFeatures },
-                                                                                                  m_renderingEngine{ window.surface(), m_device },
+                                                                                                  m_renderingEngine{ window, m_device, m_jobs },
                                                                                                   m_frameTime{ 1.0f / fixedFPS },
-                                                                                                  m_cameraScraper{ std::make_unique<CameraScraper>(m_renderingEngine) }
+                                                                                                  m_spatialGrid{ std::make_unique<SpatialGrid>() },
+                                                                                                  m_transformPropagation{ std::make_unique<TransformPropagation>() },
+                                                                                                  m_cameraScraper{ std::make_unique<CameraScraper>(m_snapshots) }
 {
-    m_renderSystems.push_back(m_cameraScraper.get());
+    // world matrices are brought up to date before anything reads them
+    m_renderSystems.addSystem(m_transformPropagation.get());
+    m_renderSystems.addSystem(m_cameraScraper.get());
+}
+
+constexpr double toMilliseconds(std::chrono::nanoseconds d)
+{
+    return static_cast<double>(d.count()) / 1000000.0;
 }
 
 void CoreEngine::run()
 {
+    if (m_window.headless()) {
+        spdlog::critical("run() needs a window to poll, use runFrames() on headless ones.");
+        throw std::runtime_error("Headless run.");
+    }
+
     bool isRunning = true;
 
     Time startTime = Clock::now();
@@ -54,7 +76,19 @@ void CoreEngine::run()
     int updateFrames = 0;
     int renderFrames = 0;
 
+    PROFILE_THREAD("Main");
+
+    std::thread renderThread;
+    if (m_pipelined) {
+        renderThread = std::thread(&CoreEngine::renderLoop, this);
+    }
+
     while (isRunning) {
+        if (m_profileFrames > 0 && !m_profiling) {
+            beginProfile();
+        }
+
+        PROFILE_ZONE("CoreEngine::frame");
         bool render = false;
 
         Time lastTime = Clock::now();
@@ -67,11 +101,21 @@ void CoreEngine::run()
         glfwPollEvents();
 
         while (unprocessedTime > m_frameTime) {
+            PROFILE_ZONE("CoreEngine::update");
+
             if (m_window.shouldClose()) {
                 isRunning = false;
             }
 
-            m_scene.updateSystems(m_updateSystems, m_frameTime);
+            if (m_input != nullptr) {
+                m_input->beginTick(m_frameTime);
+            }
+
+            m_updateSystems.run(m_frameTime);
+            m_scene.events().swap();// this tick's events are read by the render systems and the next tick
+
+            // outside the scheduler so every system of the next tick sees this tick's positions
+            m_scene.updateSystem(m_spatialGrid.get(), m_frameTime);
 
             unprocessedTime -= m_frameTime;
             render = true;
@@ -79,20 +123,280 @@ void CoreEngine::run()
         }
 
         if (render) {
-            m_scene.updateSystems(m_renderSystems, m_frameTime);
-            m_renderingEngine.render();
-            m_renderingEngine.present();
+            // extraction into the back snapshot, publishing waits for the previous frame to be drawn
+            m_renderSystems.run(m_frameTime);
+
+            bool published;
+            {
+                PROFILE_ZONE("RenderSnapshots::publish");
+                published = m_snapshots.publish();
+            }
+
+            if (!published) {// the render thread failed
+                isRunning = false;
+            } else if (!m_pipelined) {
+                drawFrame(*m_snapshots.acquire());
+            }
+
             renderFrames++;
+
+            if (m_profiling && --m_profileFrames == 0) {
+                endProfile();
+            }
         } else {
             unprocessedFrames++;
         }
 
         if (frameCountTime >= 1.0f) {
             spdlog::debug("Unprocessed Frames: {}, Update Frames: {}, Render Frames: {}", unprocessedFrames, updateFrames, renderFrames);
+
+            if (!m_statsFile.empty()) {
+                writeStats(frameCountTime, unprocessedFrames, updateFrames, renderFrames);
+            }
+
             unprocessedFrames = 0;
             updateFrames = 0;
             renderFrames = 0;
             frameCountTime = 0.0f;
         }
     }
+
+    if (renderThread.joinable()) {
+        m_snapshots.close();
+        renderThread.join();
+
+        if (m_renderError) {
+            std::rethrow_exception(m_renderError);
+        }
+    }
+}
+
+std::vector<FrameTiming> CoreEngine::runFrames(uint32_t frames)
+{
+    PROFILE_THREAD("Main");
+
+    std::vector<FrameTiming> timings(frames);
+    std::vector<double> gpuTimes(frames, 0.0);
+    m_renderingEngine.gpuTimer().setHistory(&gpuTimes);
+
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        if (m_profileFrames > 0 && !m_profiling) {
+            beginProfile();
+        }
+
+        PROFILE_ZONE("CoreEngine::frame");
+        FrameTiming& timing = timings[frame];
+
+        Time start = Clock::now();
+        {
+            PROFILE_ZONE("CoreEngine::update");
+
+            if (m_input != nullptr) {
+                m_input->beginTick(m_frameTime);
+            }
+
+            m_updateSystems.run(m_frameTime);
+            m_scene.events().swap();
+            m_scene.updateSystem(m_spatialGrid.get(), m_frameTime);
+        }
+
+        Time updated = Clock::now();
+        m_renderSystems.run(m_frameTime);
+        m_snapshots.publish();
+        m_renderingEngine.render(*m_snapshots.acquire());
+
+        Time submitted = Clock::now();
+        m_renderingEngine.present();
+        m_snapshots.release();
+
+        timing.m_update = toMilliseconds(updated - start);
+        timing.m_render = toMilliseconds(submitted - updated);
+        timing.m_present = toMilliseconds(Clock::now() - submitted);
+
+        if (m_profiling && --m_profileFrames == 0) {
+            endProfile();
+        }
+    }
+
+    if (m_profiling) {// asked for more frames than were run
+        endProfile();
+    }
+
+    // the last frames are still in flight
+    m_renderingEngine.finish();
+    m_renderingEngine.gpuTimer().setHistory(nullptr);
+
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        timings[frame].m_gpu = gpuTimes[frame];
+    }
+
+    return timings;
+}
+
+bool CoreEngine::reportFrameTimings(const std::vector<FrameTiming>& timings, const std::string& path)
+{
+    std::FILE* file = nullptr;
+    if (!path.empty()) {
+        file = std::fopen(path.c_str(), "w");
+
+        if (file == nullptr) {
+            spdlog::error("Failed to write frame timings to {}", path);
+        }
+    }
+
+    // averages, 95th percentiles and maxima of the CPU and GPU frame times
+    std::vector<double> cpu;
+    std::vector<double> gpu;
+    for (const FrameTiming& timing : timings) {
+        cpu.push_back(timing.m_update + timing.m_render + timing.m_present);
+        gpu.push_back(timing.m_gpu);
+    }
+
+    if (file != nullptr) {
+        std::fprintf(file, "{\n  \"frames\": %zu,\n", timings.size());
+    }
+
+    std::pair<const char*, std::vector<double>*> summaries[] = { { "cpu", &cpu }, { "gpu", &gpu } };
+    for (auto& [name, times] : summaries) {
+        double average = 0.0;
+        for (double time : *times) {
+            average += time;
+        }
+        average = times->empty() ? 0.0 : average / static_cast<double>(times->size());
+
+        std::sort(times->begin(), times->end());
+        double p95 = times->empty() ? 0.0 : (*times)[(times->size() - 1) * 95 / 100];
+        double max = times->empty() ? 0.0 : times->back();
+
+        spdlog::info("{} frame time over {} frames: average {:.3f} ms, p95 {:.3f} ms, max {:.3f} ms", name, times->size(), average, p95, max);
+        if (file != nullptr) {
+            std::fprintf(file, "  \"%s\": { \"average_ms\": %.4f, \"p95_ms\": %.4f, \"max_ms\": %.4f },\n", name, average, p95, max);
+        }
+    }
+
+    if (file == nullptr) {
+        return path.empty();
+    }
+
+    std::fprintf(file, "  \"timings\": [\n");
+    for (size_t i = 0; i < timings.size(); i++) {
+        const FrameTiming& timing = timings[i];
+        std::fprintf(file, "    { \"update_ms\": %.4f, \"render_ms\": %.4f, \"present_ms\": %.4f, \"gpu_ms\": %.4f }%s\n",
+            timing.m_update, timing.m_render, timing.m_present, timing.m_gpu, i + 1 < timings.size() ? "," : "");
+    }
+
+    std::fprintf(file, "  ]\n}\n");
+    std::fclose(file);
+    return true;
+}
+
+void CoreEngine::renderLoop()
+{
+    PROFILE_THREAD("Render");
+
+    try {
+        while (const RenderSnapshot* snapshot = m_snapshots.acquire()) {
+            drawFrame(*snapshot);
+        }
+    } catch (...) {
+        // handed to the simulation thread, which stops at its next publish
+        m_renderError = std::current_exception();
+        m_snapshots.close();
+    }
+}
+
+void CoreEngine::drawFrame(const RenderSnapshot& snapshot)
+{
+    m_renderingEngine.render(snapshot);
+    m_renderingEngine.present();
+    m_snapshots.release();
+}
+
+void CoreEngine::captureProfile(std::string path, uint32_t frames)
+{
+#ifdef ENGINE_PROFILER
+    m_profilePath = std::move(path);
+    m_profileFrames = frames;
+#else
+    spdlog::warn("Can't profile into {}, build with ENABLE_PROFILER to compile the profiler in.", path);
+    (void)frames;
+#endif
+}
+
+void CoreEngine::beginProfile()
+{
+#ifdef ENGINE_PROFILER
+    Profiler::beginCapture();
+    m_profiling = true;
+#endif
+}
+
+void CoreEngine::endProfile()
+{
+#ifdef ENGINE_PROFILER
+    if (Profiler::endCapture(m_profilePath)) {
+        spdlog::info("Wrote the profile to {}", m_profilePath);
+    } else {
+        spdlog::error("Failed to write the profile to {}", m_profilePath);
+    }
+
+    m_profiling = false;
+#endif
+}
+
+void CoreEngine::writeStats(float seconds, int unprocessedFrames, int updateFrames, int renderFrames)
+{
+    std::FILE* file = std::fopen(m_statsFile.c_str(), "w");
+    if (file == nullptr) {
+        spdlog::error("Failed to write stats to {}, turning them off.", m_statsFile);
+        m_statsFile.clear();
+        return;
+    }
+
+    const ComponentPool& pool = m_scene.pool();
+    std::fprintf(file, "{\n  \"seconds\": %.3f,\n", static_cast<double>(seconds));
+    std::fprintf(file, "  \"frames\": { \"unprocessed\": %d, \"update\": %d, \"render\": %d },\n", unprocessedFrames, updateFrames, renderFrames);
+    std::fprintf(file, "  \"memory\": { \"bytes\": %zu, \"peak_bytes\": %zu, \"reserved_bytes\": %zu },\n", pool.usage().m_current, pool.usage().m_peak, pool.reservedBytes());
+
+    const GpuTimer& gpu = m_renderingEngine.gpuTimer();
+    std::fprintf(file, "  \"gpu\": { \"supported\": %s, \"frame_ms\": %.4f, \"passes\": [", gpu.supported() ? "true" : "false", gpu.frameMilliseconds());
+    for (uint32_t pass = 0; pass < gpu.passCount(); pass++) {
+        std::fprintf(file, "%s{ \"name\": \"%s\", \"ms\": %.4f }", pass > 0 ? ", " : " ", gpu.passName(pass), gpu.passMilliseconds(pass));
+    }
+    std::fprintf(file, " ] },\n");
+
+    std::vector<ComponentStats> components = m_scene.componentStats();
+    m_previousCounters.resize(BaseECSComponent::getTypeCount());
+
+    std::fprintf(file, "  \"components\": [\n");
+    for (size_t i = 0; i < components.size(); i++) {
+        const ComponentStats& stats = components[i];
+        ComponentPool::Counters& previous = m_previousCounters[stats.m_typeID];
+
+        double addRate = static_cast<double>(stats.m_counters.m_adds - previous.m_adds) / static_cast<double>(seconds);
+        double removeRate = static_cast<double>(stats.m_counters.m_removes - previous.m_removes) / static_cast<double>(seconds);
+        previous = stats.m_counters;
+
+        std::fprintf(file, "    { \"name\": \"%s\", \"live\": %zu, \"capacity\": %zu, \"bytes\": %zu, \"peak_bytes\": %zu, \"allocations\": %llu, \"adds_per_second\": %.1f, \"removes_per_second\": %.1f, \"bytes_moved\": %llu }%s\n",
+            stats.m_name, stats.m_live, stats.m_capacity, stats.m_bytes.m_current, stats.m_bytes.m_peak, static_cast<unsigned long long>(stats.m_counters.m_allocations), addRate, removeRate, static_cast<unsigned long long>(stats.m_counters.m_bytesMoved), i + 1 < components.size() ? "," : "");
+    }
+
+    std::fprintf(file, "  ],\n  \"systems\": [\n");
+
+    std::vector<std::pair<const char*, ECSSystem*>> systems;
+    for (ECSSystem* system : m_updateSystems.systems()) {
+        systems.emplace_back("update", system);
+    }
+    for (ECSSystem* system : m_renderSystems.systems()) {
+        systems.emplace_back("render", system);
+    }
+
+    for (size_t i = 0; i < systems.size(); i++) {
+        const ECSSystem* system = systems[i].second;
+        std::fprintf(file, "    { \"name\": \"%s\", \"group\": \"%s\", \"last_ms\": %.4f, \"average_ms\": %.4f, \"runs\": %llu }%s\n",
+            system->name(), systems[i].first, system->lastRunMilliseconds(), system->averageRunMilliseconds(), static_cast<unsigned long long>(system->runCount()), i + 1 < systems.size() ? "," : "");
+    }
+
+    std::fprintf(file, "  ]\n}\n");
+    std::fclose(file);
 }
@@ -16,11 +16,29 @@
 
 #pragma once
 
+#include <exception>
+#include <string>
+#include <vector>
+
 #include "ecs/ECS.hpp"
 #include "ecs/ECSSystem.hpp"
+#include "ecs/SystemScheduler.hpp"
+#include "input/Input.hpp"
+#include "jobs/JobSystem.hpp"
 #include "window.hpp"
 #include "rendering/Device.hpp"
 #include "rendering/RenderingEngine.hpp"
+#include "systems/SpatialGrid.hpp"
+#include "systems/TransformPropagation.hpp"
+
+// CPU and GPU time of one frame of runFrames(), in milliseconds
+struct FrameTiming
+{
+    double m_update = 0.0;// update systems of the tick
+    double m_render = 0.0;// render systems and recording/submitting the frame
+    double m_present = 0.0;// presenting, mostly waiting for the GPU
+    double m_gpu = 0.0;// all passes, 0 without timestamp support
+};
 
 class CoreEngine
 {
@@ -29,23 +47,77 @@ class CoreEngine
 
     void run();
 
+    // Runs exactly frames ticks, drawing every one of them right after it, as fast as it can and
+    // without the render thread so runs are repeatable. Meant for benchmarking headless windows.
+    std::vector<FrameTiming> runFrames(uint32_t frames);
+
+    // headless only, the last frame drawn by runFrames() as a PNG
+    inline bool saveFrame(const std::string& path) const { return m_renderingEngine.saveFrame(path); }
+
+    // logs a summary of the timings, a path also gets it and every frame written as JSON
+    static bool reportFrameTimings(const std::vector<FrameTiming>& timings, const std::string& path = "");
+
     constexpr ECS& scene() { return m_scene; }
     constexpr const ECS& scene() const { return m_scene; }
 
-    inline void addUpdateSystem(ECSSystem* system) { m_updateSystems.push_back(system); }
-    inline void addRenderSystem(ECSSystem* system) { m_renderSystems.push_back(system); }
+    constexpr JobSystem& jobs() { return m_jobs; }
+
+    // positions of every entity with a Transform as of the last update tick, safe to query
+    // from render systems and job system workers
+    constexpr const SpatialGrid& spatialGrid() const { return *m_spatialGrid; }
+
+    inline void addUpdateSystem(ECSSystem* system) { m_updateSystems.addSystem(system); }
+    inline void addRenderSystem(ECSSystem* system) { m_renderSystems.addSystem(system); }
+
+    // sampled at the start of every update tick, before the update systems run
+    inline void setInput(Input* input) { m_input = input; }
+
+    // once a second run() overwrites the file with the frame counters, component storage stats
+    // and system timings as JSON, empty turns it off
+    inline void setStatsFile(std::string path) { m_statsFile = std::move(path); }
+
+    // Submits and presents frames on a render thread of their own, so the simulation of the next
+    // tick overlaps drawing the current frame. Has to be set before run().
+    inline void setPipelined(bool pipelined) { m_pipelined = pipelined; }
+
+    // Profiles the next frames rendered by run() and writes them to path as a Chrome trace.
+    // Needs a build with ENABLE_PROFILER, call it from the main thread.
+    void captureProfile(std::string path, uint32_t frames);
 
   private:
     const Window& m_window;
     ECS m_scene;
+    JobSystem m_jobs;
 
-    std::vector<ECSSystem*> m_updateSystems;
-    std::vector<ECSSystem*> m_renderSystems;
+    SystemScheduler m_updateSystems;
+    SystemScheduler m_renderSystems;
 
     Device m_device;
     RenderingEngine m_renderingEngine;
 
     float m_frameTime;
+    Input* m_input = nullptr;
+
+    // filled by the render systems, drawn by drawFrame
+    RenderSnapshots m_snapshots;
+    bool m_pipelined = false;
+    std::exception_ptr m_renderError;// set by the render thread before it gives up
 
+    std::unique_ptr<SpatialGrid> m_spatialGrid;
+    std::unique_ptr<TransformPropagation> m_transformPropagation;
     std::unique_ptr<CameraScraper> m_cameraScraper;
+
+    std::string m_statsFile;
+
+    std::string m_profilePath;
+    uint32_t m_profileFrames = 0;// left to capture
+    bool m_profiling = false;
+    std::vector<ComponentPool::Counters> m_previousCounters;// per type ID, for the add/remove rates
+
+    void renderLoop();
+    void beginProfile();
+    void endProfile();
+    void drawFrame(const RenderSnapshot& snapshot);
+
+    void writeStats(float seconds, int unprocessedFrames, int updateFrames, int renderFrames);
 };
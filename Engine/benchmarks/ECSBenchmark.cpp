@@ -0,0 +1,260 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// Core ECS operations at 10k, 100k and 1M entities. Prints a table and, given a path, writes the
+// results as JSON so runs can be compared:
+//
+//   ECSBenchmark results.json
+//
+//   { "unit": "ms", "repetitions": 5, "results": [ { "name": "create", "entities": 10000,
+//     "median_ms": 0.41, "ns_per_entity": 41.0 }, ... ] }
+
+#include "../components/Transform.hpp"
+#include "../components/Velocity.hpp"
+#include "../ecs/BatchSystem.hpp"
+#include "../ecs/ECS.hpp"
+#include "../ecs/ECSPrefab.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static constexpr uint32_t ENTITY_COUNTS[] = { 10000, 100000, 1000000 };
+static constexpr int REPETITIONS = 5;
+
+struct Result
+{
+    const char* m_name;
+    uint32_t m_entities;
+    double m_milliseconds;
+};
+
+class Drift : public BatchSystem<Transform>
+{
+  public:
+    virtual void updateBatch(float delta, std::span<Transform> transforms) override
+    {
+        for (Transform& transform : transforms) {
+            transform.m_position.y += delta;
+        }
+    }
+};
+
+class Integrate : public BatchSystem<Transform, const Velocity>
+{
+  public:
+    virtual void updateBatch(float delta, std::span<Transform> transforms, std::span<const Velocity> velocities) override
+    {
+        for (size_t i = 0; i < transforms.size(); i++) {
+            transforms[i].m_position += velocities[i].m_linear * delta;
+        }
+    }
+};
+
+// Every benchmark is a fixture: the constructor sets up a fresh world and isn't timed, run() is.
+// Fixtures get rebuilt for every repetition so no run sees another run's leftovers.
+struct Fixture
+{
+    ECS m_scene;
+    std::vector<Entity_t> m_entities;
+
+    Fixture(uint32_t count, const ECSPrefab& prefab)
+    {
+        for (Entity_t entity : m_scene.createEntities(count, prefab)) {
+            m_entities.push_back(entity);
+        }
+    }
+};
+
+struct Create
+{
+    ECS m_scene;
+    uint32_t m_count;
+
+    explicit Create(uint32_t count) : m_count(count) {}
+
+    void run()
+    {
+        for (uint32_t i = 0; i < m_count; i++) {
+            [[maybe_unused]] Entity_t entity = m_scene.createEntity();
+        }
+    }
+};
+
+struct Destroy : Fixture
+{
+    explicit Destroy(uint32_t count) : Fixture(count, ECSPrefab().add(Transform{}).add(Velocity{})) {}
+
+    void run()
+    {
+        for (Entity_t entity : m_entities) {
+            m_scene.removeEntity(entity);
+        }
+    }
+};
+
+struct AddComponent : Fixture
+{
+    explicit AddComponent(uint32_t count) : Fixture(count, ECSPrefab().add(Transform{})) {}
+
+    void run()
+    {
+        for (Entity_t entity : m_entities) {
+            m_scene.addComponent(entity, Velocity{});
+        }
+    }
+};
+
+struct RemoveComponent : Fixture
+{
+    explicit RemoveComponent(uint32_t count) : Fixture(count, ECSPrefab().add(Transform{}).add(Velocity{})) {}
+
+    void run()
+    {
+        for (Entity_t entity : m_entities) {
+            m_scene.removeComponent<Velocity>(entity);
+        }
+    }
+};
+
+struct Get : Fixture
+{
+    float m_sum = 0.0f;
+
+    explicit Get(uint32_t count) : Fixture(count, ECSPrefab().add(Transform{}).add(Velocity{})) {}
+
+    void run()
+    {
+        for (Entity_t entity : m_entities) {
+            const Transform* transform = m_scene.get<const Transform>(entity);
+            if (transform != nullptr) {// always, but -Wnull-dereference can't know
+                m_sum += transform->m_position.x;
+            }
+        }
+    }
+};
+
+template<typename System>
+struct Iterate : Fixture
+{
+    System m_system;
+    std::vector<ECSSystem*> m_systems{ &m_system };
+
+    explicit Iterate(uint32_t count) : Fixture(count, ECSPrefab().add(Transform{}).add(Velocity{}))
+    {
+        m_scene.updateSystems(m_systems, 0.0f);// resolves the query up front
+    }
+
+    void run()
+    {
+        m_scene.updateSystems(m_systems, 1.0f / 60.0f);
+    }
+};
+
+// every entity gains and loses a component, then a tenth of them get respawned
+struct Churn : Fixture
+{
+    explicit Churn(uint32_t count) : Fixture(count, ECSPrefab().add(Transform{})) {}
+
+    void run()
+    {
+        for (Entity_t entity : m_entities) {
+            m_scene.addComponent(entity, Velocity{});
+        }
+
+        for (Entity_t entity : m_entities) {
+            m_scene.removeComponent<Velocity>(entity);
+        }
+
+        for (size_t i = 0; i < m_entities.size(); i += 10) {
+            m_scene.removeEntity(m_entities[i]);
+            m_entities[i] = m_scene.createEntity();
+            m_scene.addComponent(m_entities[i], Transform{});
+        }
+    }
+};
+
+template<typename Benchmark>
+static Result measure(const char* name, uint32_t count)
+{
+    std::vector<double> samples;
+
+    for (int i = 0; i < REPETITIONS; i++) {
+        auto benchmark = std::make_unique<Benchmark>(count);
+
+        auto start = Clock::now();
+        benchmark->run();
+        samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    return Result{ name, count, samples[samples.size() / 2] };
+}
+
+static double nanosecondsPerEntity(const Result& result)
+{
+    return result.m_milliseconds * 1000000.0 / result.m_entities;
+}
+
+static bool writeJson(const char* path, const std::vector<Result>& results)
+{
+    std::FILE* file = std::fopen(path, "w");
+    if (file == nullptr) {
+        return false;
+    }
+
+    std::fprintf(file, "{\n  \"unit\": \"ms\",\n  \"repetitions\": %d,\n  \"results\": [\n", REPETITIONS);
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& result = results[i];
+        std::fprintf(file, "    { \"name\": \"%s\", \"entities\": %u, \"median_ms\": %.6f, \"ns_per_entity\": %.3f }%s\n", result.m_name, result.m_entities, result.m_milliseconds, nanosecondsPerEntity(result), i + 1 < results.size() ? "," : "");
+    }
+
+    std::fprintf(file, "  ]\n}\n");
+    return std::fclose(file) == 0;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<Result> results;
+
+    for (uint32_t count : ENTITY_COUNTS) {
+        results.push_back(measure<Create>("create", count));
+        results.push_back(measure<Destroy>("destroy", count));
+        results.push_back(measure<AddComponent>("add_component", count));
+        results.push_back(measure<RemoveComponent>("remove_component", count));
+        results.push_back(measure<Get>("get", count));
+        results.push_back(measure<Iterate<Drift>>("iterate_single", count));
+        results.push_back(measure<Iterate<Integrate>>("iterate_multi", count));
+        results.push_back(measure<Churn>("churn", count));
+    }
+
+    std::printf("%18s %10s %12s %14s\n", "", "entities", "median ms", "ns / entity");
+    for (const Result& result : results) {
+        std::printf("%18s %10u %12.3f %14.2f\n", result.m_name, result.m_entities, result.m_milliseconds, nanosecondsPerEntity(result));
+    }
+
+    if (argc > 1 && !writeJson(argv[1], results)) {
+        std::fprintf(stderr, "failed to write %s\n", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// Measures how parallelFor scales with the number of threads on a compute bound workload.
+
+#include "../jobs/JobSystem.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static constexpr uint32_t ELEMENT_COUNT = 1 << 22;
+static constexpr uint32_t GRAIN_SIZE = 4096;
+static constexpr int REPETITIONS = 15;
+
+static void workload(std::vector<float>& values, uint32_t first, uint32_t last)
+{
+    for (uint32_t i = first; i < last; i++) {
+        float x = values[i];
+        for (int k = 0; k < 16; k++) {
+            x = std::sqrt(x * x + 1.0f) * 0.5f + std::sin(x) * 0.25f;
+        }
+        values[i] = x;
+    }
+}
+
+template<typename Function>
+static double medianMilliseconds(Function&& function)
+{
+    std::vector<double> samples;
+
+    for (int i = 0; i < REPETITIONS; i++) {
+        auto start = Clock::now();
+        function();
+        samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+int main()
+{
+    std::vector<float> values(ELEMENT_COUNT, 1.0f);
+    uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 2u);
+
+    double serial = medianMilliseconds([&] { workload(values, 0, ELEMENT_COUNT); });
+    std::printf("%8s %12s %10s\n", "threads", "median ms", "speedup");
+    std::printf("%8u %12.3f %10.2f\n", 1u, serial, 1.0);
+
+    for (uint32_t threads = 2; threads <= maxThreads; threads *= 2) {
+        JobSystem jobs(threads - 1);// the calling thread works while it waits
+
+        double parallel = medianMilliseconds([&] {
+            jobs.parallelFor(0, ELEMENT_COUNT, GRAIN_SIZE, [&](uint32_t first, uint32_t last) { workload(values, first, last); });
+        });
+
+        std::printf("%8u %12.3f %10.2f\n", threads, parallel, serial / parallel);
+
+        if (threads < maxThreads && threads * 2 > maxThreads) {
+            threads = maxThreads / 2;// always finish on the full machine
+        }
+    }
+
+    return 0;
+}
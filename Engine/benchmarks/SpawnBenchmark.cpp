@@ -0,0 +1,83 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// Spawns a million entities one at a time and through ECS::createEntities.
+
+#include "../components/Camera.hpp"
+#include "../components/Transform.hpp"
+#include "../components/Velocity.hpp"
+#include "../ecs/ECS.hpp"
+#include "../ecs/ECSPrefab.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static constexpr uint32_t ENTITY_COUNT = 1000000;
+static constexpr int REPETITIONS = 5;
+
+template<typename Function>
+static double medianMilliseconds(Function&& function)
+{
+    std::vector<double> samples;
+
+    for (int i = 0; i < REPETITIONS; i++) {
+        ECS scene;// fresh world every run, teardown isn't timed
+
+        auto start = Clock::now();
+        function(scene);
+        samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+int main()
+{
+    Transform transform;
+    transform.m_position = glm::vec3(1.0f, 2.0f, 3.0f);
+
+    Velocity velocity;
+    velocity.m_linear = glm::vec3(0.0f, 0.0f, 1.0f);
+
+    ECSPrefab prefab;
+    prefab.add(transform).add(velocity).add(Camera{});
+
+    double single = medianMilliseconds([&](ECS& scene) {
+        for (uint32_t i = 0; i < ENTITY_COUNT; i++) {
+            Entity_t entity = scene.createEntity();
+            scene.addComponent(entity, transform);
+            scene.addComponent(entity, velocity);
+            scene.addComponent(entity, Camera{});
+        }
+    });
+
+    double bulk = medianMilliseconds([&](ECS& scene) {
+        [[maybe_unused]] EntityRange range = scene.createEntities(ENTITY_COUNT, prefab);
+    });
+
+    std::printf("%u entities with Transform, Velocity and Camera\n", ENTITY_COUNT);
+    std::printf("%22s %12s\n", "", "median ms");
+    std::printf("%22s %12.3f\n", "createEntity + add", single);
+    std::printf("%22s %12.3f\n", "createEntities", bulk);
+    std::printf("%22s %12.2fx\n", "speedup", single / bulk);
+
+    return 0;
+}
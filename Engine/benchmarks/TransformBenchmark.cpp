@@ -0,0 +1,122 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// Compares the per entity glm path against the SoA transform kernels, integrating
+// velocities and composing world matrices for a range of entity counts.
+
+#include "../components/Transform.hpp"
+#include "../components/Velocity.hpp"
+#include "../math/TransformKernels.hpp"
+#include "../math/TransformSoA.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static constexpr int REPETITIONS = 15;
+static constexpr float DELTA = 1.0f / 60.0f;
+
+template<typename Function>
+static double medianMilliseconds(Function&& function)
+{
+    std::vector<double> samples;
+
+    for (int i = 0; i < REPETITIONS; i++) {
+        auto start = Clock::now();
+        function();
+        samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+static void glmUpdate(std::vector<Transform>& transforms, const std::vector<Velocity>& velocities, std::vector<glm::mat4>& worlds)
+{
+    for (size_t i = 0; i < transforms.size(); i++) {
+        Transform& transform = transforms[i];
+        const Velocity& velocity = velocities[i];
+
+        float speed = glm::length(velocity.m_angular);
+        transform.m_position += velocity.m_linear * DELTA;
+        transform.m_orientation = glm::normalize(glm::angleAxis(speed * DELTA, velocity.m_angular / speed) * transform.m_orientation);
+
+        worlds[i] = glm::translate(glm::mat4(1.0f), transform.m_position) * glm::toMat4(transform.m_orientation) * glm::scale(glm::mat4(1.0f), transform.m_scale);
+    }
+}
+
+static float maxDifference(const std::vector<glm::mat4>& a, const std::vector<glm::mat4>& b)
+{
+    float difference = 0.0f;
+
+    for (size_t i = 0; i < a.size(); i++) {
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) {
+                difference = std::max(difference, std::abs(a[i][c][r] - b[i][c][r]));
+            }
+        }
+    }
+
+    return difference;
+}
+
+int main()
+{
+    std::printf("SIMD kernels: %s\n", transformKernelsInstructionSet());
+    std::printf("%10s %12s %12s %12s %10s %10s\n", "entities", "glm ms", "scalar ms", "simd ms", "speedup", "max diff");
+
+    for (size_t count : { 1000u, 10000u, 100000u, 1000000u }) {
+        std::vector<Transform> transforms(count);
+        std::vector<Velocity> velocities(count);
+
+        for (size_t i = 0; i < count; i++) {
+            float f = static_cast<float>(i);
+            transforms[i].m_position = glm::vec3(f, f * 0.5f, -f);
+            transforms[i].m_scale = glm::vec3(1.0f + static_cast<float>(i % 3));
+            velocities[i].m_linear = glm::vec3(1.0f, 0.0f, static_cast<float>(i % 7));
+            velocities[i].m_angular = glm::vec3(0.1f, 0.5f + static_cast<float>(i % 5), 0.25f);
+        }
+
+        TransformSoA soa(count);
+        soa.load(transforms);
+        soa.load(velocities);
+
+        std::vector<glm::mat4> glmWorlds(count);
+        std::vector<glm::mat4> scalarWorlds(count);
+        std::vector<glm::mat4> simdWorlds(count);
+
+        double glmTime = medianMilliseconds([&] { glmUpdate(transforms, velocities, glmWorlds); });
+        double scalarTime = medianMilliseconds([&] {
+            integrateVelocitiesScalar(soa, DELTA);
+            composeWorldMatricesScalar(soa, scalarWorlds.data());
+        });
+        double simdTime = medianMilliseconds([&] {
+            integrateVelocities(soa, DELTA);
+            composeWorldMatrices(soa, simdWorlds.data());
+        });
+
+        // both SoA paths see the same input here, so their matrices have to agree
+        composeWorldMatricesScalar(soa, scalarWorlds.data());
+
+        std::printf("%10zu %12.3f %12.3f %12.3f %10.2f %10.2g\n", count, glmTime, scalarTime, simdTime, glmTime / simdTime, static_cast<double>(maxDifference(scalarWorlds, simdWorlds)));
+    }
+
+    return 0;
+}
@@ -0,0 +1,219 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Archetype.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+static constexpr size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+Archetype::Archetype(std::vector<uint32_t> types, ComponentPool& pool) : m_pool(pool), m_types(std::move(types))
+{
+    size_t rowBytes = sizeof(uint32_t);
+    m_columnLookup.fill(-1);
+    m_headerBytes = alignUp(m_types.size() * sizeof(uint32_t), CACHE_LINE);
+
+    for (uint32_t type : m_types) {
+        m_mask.set(type);
+        m_columnLookup[type] = static_cast<int16_t>(m_columnSizes.size());
+        m_columnSizes.push_back(BaseECSComponent::getTypeSize(type));
+        rowBytes += m_columnSizes.back();
+    }
+
+    m_chunkCapacity = static_cast<uint32_t>((CHUNK_SIZE - m_headerBytes) / rowBytes);
+
+    if (m_chunkCapacity == 0) {// a single component bigger than a chunk, give it a chunk of its own
+        m_chunkCapacity = 1;
+        m_chunkBytes = layoutBytes(1);
+    }
+
+    // padding every column to a cache line can push us past the chunk size
+    while (m_chunkCapacity > 1 && layoutBytes(m_chunkCapacity) > m_chunkBytes) {
+        m_chunkCapacity--;
+    }
+
+    size_t offset = m_headerBytes + alignUp(m_chunkCapacity * sizeof(uint32_t), CACHE_LINE);
+    for (size_t size : m_columnSizes) {
+        m_columnOffsets.push_back(offset);
+        offset += alignUp(m_chunkCapacity * size, CACHE_LINE);
+    }
+}
+
+Archetype::~Archetype()
+{
+    for (uint32_t row = 0; row < m_size; row++) {
+        for (size_t i = 0; i < m_types.size(); i++) {
+            BaseECSComponent::getTypeFreeFunc(m_types[i])(reinterpret_cast<BaseECSComponent*>(component(row, i)));
+        }
+    }
+
+    for (auto& chunk : m_chunks) {
+        freeChunk(chunk);
+    }
+}
+
+uint32_t Archetype::allocateRow(uint32_t entityIndex, uint32_t tick)
+{
+    if (m_size == m_chunks.size() * m_chunkCapacity) {
+        addChunk();
+    }
+
+    uint32_t row = m_size++;
+    m_rowsVersion++;
+    ArchetypeChunk& chunk = m_chunks[row / m_chunkCapacity];
+    entities(chunk)[chunk.m_count++] = entityIndex;
+    markRowChanged(row, tick);
+
+    return row;
+}
+
+uint32_t Archetype::allocateRows(uint32_t firstEntity, uint32_t count, uint32_t tick)
+{
+    uint32_t firstRow = m_size;
+    m_rowsVersion++;
+    size_t chunkCount = (static_cast<size_t>(m_size) + count + m_chunkCapacity - 1) / m_chunkCapacity;
+
+    m_chunks.reserve(chunkCount);
+    while (m_chunks.size() < chunkCount) {
+        addChunk();
+    }
+
+    for (uint32_t i = 0; i < count;) {
+        ArchetypeChunk& chunk = m_chunks[m_size / m_chunkCapacity];
+        uint32_t* chunkEntities = entities(chunk) + chunk.m_count;
+        uint32_t rows = std::min(m_chunkCapacity - chunk.m_count, count - i);
+
+        for (uint32_t r = 0; r < rows; r++) {
+            chunkEntities[r] = firstEntity + i + r;
+        }
+
+        chunk.m_count += rows;
+        markRowChanged(m_size, tick);
+        m_size += rows;
+        i += rows;
+    }
+
+    return firstRow;
+}
+
+uint32_t Archetype::allocateRows(const uint32_t* entityIndices, uint32_t count, uint32_t tick)
+{
+    uint32_t firstRow = m_size;
+    m_rowsVersion++;
+    size_t chunkCount = (static_cast<size_t>(m_size) + count + m_chunkCapacity - 1) / m_chunkCapacity;
+
+    m_chunks.reserve(chunkCount);
+    while (m_chunks.size() < chunkCount) {
+        addChunk();
+    }
+
+    for (uint32_t i = 0; i < count;) {
+        ArchetypeChunk& chunk = m_chunks[m_size / m_chunkCapacity];
+        uint32_t rows = std::min(m_chunkCapacity - chunk.m_count, count - i);
+
+        std::memcpy(entities(chunk) + chunk.m_count, entityIndices + i, rows * sizeof(uint32_t));
+
+        chunk.m_count += rows;
+        markRowChanged(m_size, tick);
+        m_size += rows;
+        i += rows;
+    }
+
+    return firstRow;
+}
+
+void Archetype::markRowChanged(uint32_t row, uint32_t tick)
+{
+    uint32_t* chunkVersions = versions(m_chunks[row / m_chunkCapacity]);
+
+    for (size_t i = 0; i < m_types.size(); i++) {
+        chunkVersions[i] = tick;
+    }
+}
+
+void Archetype::addChunk()
+{
+    ArchetypeChunk chunk;
+    chunk.m_memory = static_cast<uint8_t*>(m_pool.allocate(m_chunkBytes));
+    m_chunks.push_back(chunk);
+
+    for (size_t i = 0; i < m_types.size(); i++) {
+        m_pool.track(m_types[i], m_chunkCapacity * m_columnSizes[i]);
+    }
+}
+
+uint32_t Archetype::removeRow(uint32_t row, uint32_t tick)
+{
+    for (size_t i = 0; i < m_types.size(); i++) {
+        BaseECSComponent::getTypeFreeFunc(m_types[i])(reinterpret_cast<BaseECSComponent*>(component(row, i)));
+    }
+
+    return releaseRow(row, tick);
+}
+
+uint32_t Archetype::releaseRow(uint32_t row, uint32_t tick)
+{
+    uint32_t lastRow = m_size - 1;
+    uint32_t movedEntity = INVALID_ROW;
+    m_rowsVersion++;
+
+    if (row != lastRow) {
+        for (size_t i = 0; i < m_types.size(); i++) {
+            BaseECSComponent::getTypeMoveFunc(m_types[i])(component(row, i), reinterpret_cast<BaseECSComponent*>(component(lastRow, i)));
+            m_pool.countMove(m_types[i], m_columnSizes[i]);
+        }
+
+        movedEntity = entity(lastRow);
+        entities(m_chunks[row / m_chunkCapacity])[row % m_chunkCapacity] = movedEntity;
+        markRowChanged(row, tick);
+    }
+
+    m_size--;
+    ArchetypeChunk& lastChunk = m_chunks.back();
+    lastChunk.m_count--;
+
+    if (lastChunk.m_count == 0) {
+        freeChunk(lastChunk);
+        m_chunks.pop_back();
+    }
+
+    return movedEntity;
+}
+
+size_t Archetype::layoutBytes(uint32_t capacity) const
+{
+    size_t bytes = m_headerBytes + alignUp(capacity * sizeof(uint32_t), CACHE_LINE);
+
+    for (size_t size : m_columnSizes) {
+        bytes += alignUp(capacity * size, CACHE_LINE);
+    }
+
+    return bytes;
+}
+
+void Archetype::freeChunk(ArchetypeChunk& chunk)
+{
+    for (size_t i = 0; i < m_types.size(); i++) {
+        m_pool.untrack(m_types[i], m_chunkCapacity * m_columnSizes[i]);
+    }
+
+    m_pool.free(chunk.m_memory, m_chunkBytes);
+    chunk.m_memory = nullptr;
+}
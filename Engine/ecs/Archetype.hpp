@@ -0,0 +1,159 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "ComponentMask.hpp"
+#include "ComponentPool.hpp"
+#include "ECSComponent.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// A fixed size block holding up to Archetype::chunkCapacity() rows. It starts with one change
+// tick per component column, then the owning entity indices and one column per component
+// type, each on its own cache line.
+struct ArchetypeChunk
+{
+    uint8_t* m_memory = nullptr;
+    uint32_t m_count = 0;
+};
+
+// Storage for every entity that has exactly the same set of components.
+class Archetype
+{
+  public:
+    static constexpr size_t CHUNK_SIZE = ComponentPool::PAGE_SIZE;
+    static constexpr size_t CACHE_LINE = ComponentPool::ALIGNMENT;
+    static constexpr uint32_t INVALID_ROW = static_cast<uint32_t>(-1);
+
+    Archetype(std::vector<uint32_t> types, ComponentPool& pool);
+    ~Archetype();
+
+    Archetype(const Archetype&) = delete;
+    void operator=(const Archetype&) = delete;
+
+    [[nodiscard]] constexpr const std::vector<uint32_t>& types() const { return m_types; }
+    [[nodiscard]] constexpr const ComponentMask& mask() const { return m_mask; }
+    [[nodiscard]] constexpr const std::vector<ArchetypeChunk>& chunks() const { return m_chunks; }
+    [[nodiscard]] constexpr uint32_t chunkCapacity() const { return m_chunkCapacity; }
+    [[nodiscard]] constexpr uint32_t size() const { return m_size; }
+
+    // bumped whenever rows get added, removed or moved, pointers into the chunks stay valid
+    // for as long as it doesn't change
+    [[nodiscard]] constexpr uint64_t rowsVersion() const { return m_rowsVersion; }
+
+    // returns the column of the component type or -1 if this archetype does not store it
+    [[nodiscard]] inline int32_t columnIndex(uint32_t typeID) const { return m_columnLookup[typeID]; }
+    [[nodiscard]] inline bool hasAll(const ComponentMask& types) const { return m_mask.containsAll(types); }
+
+    [[nodiscard]] inline uint32_t* entities(const ArchetypeChunk& chunk) const
+    {
+        return static_cast<uint32_t*>(static_cast<void*>(chunk.m_memory + m_headerBytes));
+    }
+
+    // change tick of the last write to a column of the chunk, see ECS::writeTick
+    [[nodiscard]] inline uint32_t version(const ArchetypeChunk& chunk, size_t column) const
+    {
+        return versions(chunk)[column];
+    }
+
+    inline void markChanged(const ArchetypeChunk& chunk, size_t column, uint32_t tick) const
+    {
+        versions(chunk)[column] = tick;
+    }
+
+    // ticks wrap around, anything less than 2^31 ticks ahead counts as newer
+    [[nodiscard]] static constexpr bool changedSince(uint32_t version, uint32_t tick)
+    {
+        return static_cast<int32_t>(version - tick) > 0;
+    }
+
+    [[nodiscard]] inline uint8_t* column(const ArchetypeChunk& chunk, size_t column) const
+    {
+        return chunk.m_memory + m_columnOffsets[column];
+    }
+
+    [[nodiscard]] inline size_t columnSize(size_t column) const { return m_columnSizes[column]; }
+
+    [[nodiscard]] inline void* component(uint32_t row, size_t column) const
+    {
+        const ArchetypeChunk& chunk = m_chunks[row / m_chunkCapacity];
+        return this->column(chunk, column) + (row % m_chunkCapacity) * m_columnSizes[column];
+    }
+
+    [[nodiscard]] inline const ArchetypeChunk& chunkOf(uint32_t row) const
+    {
+        return m_chunks[row / m_chunkCapacity];
+    }
+
+    [[nodiscard]] inline uint32_t entity(uint32_t row) const
+    {
+        return entities(m_chunks[row / m_chunkCapacity])[row % m_chunkCapacity];
+    }
+
+    // appends a row with uninitialized components, the caller constructs every column.
+    // structural changes mark every column of the touched chunks with tick.
+    [[nodiscard]] uint32_t allocateRow(uint32_t entityIndex, uint32_t tick);
+
+    // appends count rows for the entities firstEntity, firstEntity + 1, ... and returns the
+    // first row. Chunks get allocated up front, components stay uninitialized.
+    [[nodiscard]] uint32_t allocateRows(uint32_t firstEntity, uint32_t count, uint32_t tick);
+
+    // same, for count arbitrary entity indices
+    [[nodiscard]] uint32_t allocateRows(const uint32_t* entityIndices, uint32_t count, uint32_t tick);
+
+    // destroys the row's components and fills the hole with the last row.
+    // returns the entity index that now lives at row, or INVALID_ROW if nothing moved.
+    uint32_t removeRow(uint32_t row, uint32_t tick);
+
+    // same as removeRow but the components were already moved out or destroyed
+    uint32_t releaseRow(uint32_t row, uint32_t tick);
+
+    // marks every column of the row's chunk
+    void markRowChanged(uint32_t row, uint32_t tick);
+
+    // cached transitions to the archetype with one more/less component type
+    std::unordered_map<uint32_t, Archetype*> m_addEdges;
+    std::unordered_map<uint32_t, Archetype*> m_removeEdges;
+
+  private:
+    ComponentPool& m_pool;
+    std::vector<uint32_t> m_types;
+    ComponentMask m_mask;
+    std::array<int16_t, ComponentMask::MAX_COMPONENT_TYPES> m_columnLookup;// dense type ID -> column table
+    std::vector<size_t> m_columnSizes;
+    std::vector<size_t> m_columnOffsets;
+
+    std::vector<ArchetypeChunk> m_chunks;
+    size_t m_headerBytes = 0;
+    size_t m_chunkBytes = CHUNK_SIZE;
+    uint32_t m_chunkCapacity = 0;
+    uint32_t m_size = 0;
+    uint64_t m_rowsVersion = 0;
+
+    [[nodiscard]] size_t layoutBytes(uint32_t capacity) const;
+    [[nodiscard]] inline uint32_t* versions(const ArchetypeChunk& chunk) const
+    {
+        return static_cast<uint32_t*>(static_cast<void*>(chunk.m_memory));
+    }
+
+    void addChunk();
+    void freeChunk(ArchetypeChunk& chunk);
+};
@@ -0,0 +1,69 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "ECSSystem.hpp"
+
+#include <span>
+#include <type_traits>
+
+// System that receives whole component columns instead of single entities.
+// Every listed component is required and archetype stored, const components are declared read only.
+//
+//   class Mover : public BatchSystem<Transform, const Velocity>
+//   {
+//       void updateBatch(float delta, std::span<Transform> transforms, std::span<const Velocity> velocities) override;
+//   };
+template<typename... Components>
+class BatchSystem : public ECSSystem
+{
+    static_assert(((std::remove_const_t<Components>::STORAGE == ComponentStorage::ARCHETYPE) && ...), "sparse set components have no columns, query them through get<>()/has<>() instead");
+
+  public:
+    BatchSystem()
+    {
+        addComponentTypes<Components...>();
+    }
+
+    // all spans have the same length, index i of every span belongs to the same entity
+    virtual void updateBatch(float delta, std::span<Components>... columns) = 0;
+
+    virtual void updateChunk(float delta, const Archetype& archetype, const ArchetypeChunk& chunk) override final
+    {
+        (markWritten<Components>(archetype, chunk), ...);
+        updateBatch(delta, column<Components>(archetype, chunk)...);
+    }
+
+    // everything goes through updateBatch
+    virtual void update([[maybe_unused]] float delta, [[maybe_unused]] Entity_t entity) override final {}
+
+  private:
+    template<typename Component>
+    void markWritten(const Archetype& archetype, const ArchetypeChunk& chunk) const
+    {
+        if constexpr (!std::is_const_v<Component>) {
+            archetype.markChanged(chunk, static_cast<size_t>(archetype.columnIndex(Component::ID)), runTick());
+        }
+    }
+
+    template<typename Component>
+    [[nodiscard]] static std::span<Component> column(const Archetype& archetype, const ArchetypeChunk& chunk)
+    {
+        size_t index = static_cast<size_t>(archetype.columnIndex(std::remove_const_t<Component>::ID));
+        return std::span<Component>(static_cast<Component*>(static_cast<void*>(archetype.column(chunk, index))), chunk.m_count);
+    }
+};
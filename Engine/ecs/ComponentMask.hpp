@@ -0,0 +1,81 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Fixed width component signature, one bit per registered component ID.
+// The word loops are plain enough for the compiler to turn into SIMD ands/compares.
+class ComponentMask
+{
+  public:
+    static constexpr size_t MAX_COMPONENT_TYPES = 256;
+    static constexpr size_t WORD_BITS = 64;
+    static constexpr size_t WORD_COUNT = MAX_COMPONENT_TYPES / WORD_BITS;
+
+    constexpr void set(uint32_t id) { m_words[id / WORD_BITS] |= (uint64_t{ 1 } << (id % WORD_BITS)); }
+    constexpr void reset(uint32_t id) { m_words[id / WORD_BITS] &= ~(uint64_t{ 1 } << (id % WORD_BITS)); }
+
+    [[nodiscard]] constexpr bool test(uint32_t id) const
+    {
+        return (m_words[id / WORD_BITS] >> (id % WORD_BITS)) & 1;
+    }
+
+    // true if every bit of other is also set in this mask
+    [[nodiscard]] constexpr bool containsAll(const ComponentMask& other) const
+    {
+        uint64_t missing = 0;
+        for (size_t i = 0; i < WORD_COUNT; i++) {
+            missing |= other.m_words[i] & ~m_words[i];
+        }
+
+        return missing == 0;
+    }
+
+    [[nodiscard]] constexpr bool intersects(const ComponentMask& other) const
+    {
+        uint64_t shared = 0;
+        for (size_t i = 0; i < WORD_COUNT; i++) {
+            shared |= other.m_words[i] & m_words[i];
+        }
+
+        return shared != 0;
+    }
+
+    [[nodiscard]] constexpr bool operator==(const ComponentMask& other) const = default;
+
+    [[nodiscard]] inline size_t hash() const
+    {
+        size_t seed = 0;
+        for (uint64_t word : m_words) {
+            seed ^= std::hash<uint64_t>{}(word) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+        }
+
+        return seed;
+    }
+
+    struct Hasher
+    {
+        inline size_t operator()(const ComponentMask& mask) const { return mask.hash(); }
+    };
+
+  private:
+    std::array<uint64_t, WORD_COUNT> m_words{};
+};
@@ -0,0 +1,87 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "ComponentPool.hpp"
+
+#include <algorithm>
+#include <new>
+
+ComponentPool::~ComponentPool()
+{
+    // the storages give back every page before the pool goes away
+    for (void* block : m_blocks) {
+        ::operator delete(block, std::align_val_t{ ALIGNMENT });
+    }
+}
+
+void* ComponentPool::allocate(size_t bytes)
+{
+    if (bytes > PAGE_SIZE) {
+        m_dedicatedBytes += bytes;
+        add(m_usage, bytes);
+        return ::operator new(bytes, std::align_val_t{ ALIGNMENT });
+    }
+
+    if (m_freePages.empty()) {
+        uint8_t* block = static_cast<uint8_t*>(::operator new(PAGES_PER_BLOCK * PAGE_SIZE, std::align_val_t{ ALIGNMENT }));
+        m_blocks.push_back(block);
+
+        // reversed so pages get handed out in address order
+        for (size_t i = PAGES_PER_BLOCK; i > 0; i--) {
+            m_freePages.push_back(block + (i - 1) * PAGE_SIZE);
+        }
+    }
+
+    void* page = m_freePages.back();
+    m_freePages.pop_back();
+    add(m_usage, PAGE_SIZE);
+
+    return page;
+}
+
+void ComponentPool::free(void* memory, size_t bytes)
+{
+    if (memory == nullptr) {
+        return;
+    }
+
+    if (bytes > PAGE_SIZE) {
+        m_dedicatedBytes -= bytes;
+        m_usage.m_current -= bytes;
+        ::operator delete(memory, std::align_val_t{ ALIGNMENT });
+        return;
+    }
+
+    m_freePages.push_back(memory);
+    m_usage.m_current -= PAGE_SIZE;
+}
+
+void ComponentPool::track(uint32_t typeID, size_t bytes)
+{
+    add(m_typeUsage[typeID], bytes);
+    m_typeCounters[typeID].m_allocations++;
+}
+
+void ComponentPool::untrack(uint32_t typeID, size_t bytes)
+{
+    m_typeUsage[typeID].m_current -= bytes;
+}
+
+void ComponentPool::add(Usage& usage, size_t bytes)
+{
+    usage.m_current += bytes;
+    usage.m_peak = std::max(usage.m_peak, usage.m_current);
+}
@@ -0,0 +1,91 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "ComponentMask.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Page allocator behind archetype chunks and sparse set storage. Pages are PAGE_SIZE bytes,
+// start on a cache line and never move, so components keep their address until their row
+// gets swapped or their page freed. Pages come from the system in blocks and freed ones are
+// recycled, entity churn doesn't go back to the system allocator. Requests bigger than a
+// page get a dedicated, equally aligned allocation.
+class ComponentPool
+{
+  public:
+    static constexpr size_t PAGE_SIZE = 16 * 1024;
+    static constexpr size_t ALIGNMENT = 64;
+    static constexpr size_t PAGES_PER_BLOCK = 16;
+
+    struct Usage
+    {
+        size_t m_current = 0;
+        size_t m_peak = 0;
+    };
+
+    // running totals per component type, rates come from sampling them twice
+    struct Counters
+    {
+        uint64_t m_allocations = 0;// chunks/pages the type got a share of
+        uint64_t m_adds = 0;
+        uint64_t m_removes = 0;
+        uint64_t m_bytesMoved = 0;// copied into holes left by swap-remove
+    };
+
+    ComponentPool() = default;
+    ~ComponentPool();
+
+    ComponentPool(const ComponentPool&) = delete;
+    void operator=(const ComponentPool&) = delete;
+
+    [[nodiscard]] void* allocate(size_t bytes);
+    void free(void* memory, size_t bytes);
+
+    // bytes of component storage held by a type, reported by the storages when they allocate/free
+    void track(uint32_t typeID, size_t bytes);
+    void untrack(uint32_t typeID, size_t bytes);
+
+    [[nodiscard]] inline const Usage& usage(uint32_t typeID) const { return m_typeUsage[typeID]; }
+
+    // reported by the ECS and the storages, structural changes are single threaded
+    inline void countAdds(uint32_t typeID, uint64_t count) { m_typeCounters[typeID].m_adds += count; }
+    inline void countRemoves(uint32_t typeID, uint64_t count) { m_typeCounters[typeID].m_removes += count; }
+    inline void countMove(uint32_t typeID, size_t bytes) { m_typeCounters[typeID].m_bytesMoved += bytes; }
+
+    [[nodiscard]] inline const Counters& counters(uint32_t typeID) const { return m_typeCounters[typeID]; }
+
+    // every page and dedicated allocation currently handed out
+    [[nodiscard]] constexpr const Usage& usage() const { return m_usage; }
+
+    // bytes taken from the system, including recycled pages
+    [[nodiscard]] constexpr size_t reservedBytes() const { return m_blocks.size() * PAGES_PER_BLOCK * PAGE_SIZE + m_dedicatedBytes; }
+
+  private:
+    std::vector<void*> m_blocks;
+    std::vector<void*> m_freePages;
+    size_t m_dedicatedBytes = 0;
+
+    Usage m_usage;
+    std::array<Usage, ComponentMask::MAX_COMPONENT_TYPES> m_typeUsage;
+    std::array<Counters, ComponentMask::MAX_COMPONENT_TYPES> m_typeCounters;
+
+    static void add(Usage& usage, size_t bytes);
+};
@@ -17,98 +17,631 @@
 #include "ECS.hpp"
 #include "ECSComponent.hpp"
 #include "ECSSystem.hpp"
+#include "../profiling/Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+ECS::ECS()
+{
+    m_emptyArchetype = findOrCreateArchetype({});
+}
 
 ECS::~ECS()
 {
-    for (auto& entry : m_components) {
-        size_t typeSize = BaseECSComponent::getTypeSize(entry.first);
+    // archetypes destroy the components they still hold
+}
+
+Entity_t ECS::createEntity()
+{
+    uint32_t index;
 
-        for (size_t i = 0; i < entry.second.size(); i += typeSize) {
-            BaseECSComponent* component = reinterpret_cast<BaseECSComponent*>(&entry.second[i]);// maybe unused ...
-            ECSFreeFunc_t freefn = BaseECSComponent::getTypeFreeFunc(entry.first);
-            freefn(component);
+    if (m_freeList.empty()) {
+        index = static_cast<uint32_t>(m_entities.size());
+        m_entities.emplace_back();
+    } else {
+        index = m_freeList.back();
+        m_freeList.pop_back();
+    }
+
+    EntityDef& entity = m_entities[index];
+    m_structureVersion++;
+    entity.m_archetype = m_emptyArchetype;
+    entity.m_row = m_emptyArchetype->allocateRow(index, writeTick());
+
+    return handle(index);
+}
+
+EntityRange ECS::createEntities(uint32_t count, const ECSPrefab& prefab)
+{
+    EntityRange range{ static_cast<uint32_t>(m_entities.size()), count };
+    std::vector<uint32_t> archetypeTypes;
+
+    for (uint32_t type : prefab.types()) {
+        if (BaseECSComponent::getTypeStorage(type) == ComponentStorage::ARCHETYPE) {
+            archetypeTypes.push_back(type);
         }
     }
+
+    Archetype* archetype = findOrCreateArchetype(std::move(archetypeTypes));
+    m_structureVersion++;
+    uint32_t firstRow = archetype->allocateRows(range.m_first, count, writeTick());
+
+    m_entities.resize(m_entities.size() + count);
+    for (uint32_t i = 0; i < count; i++) {
+        EntityDef& def = m_entities[range.m_first + i];
+        def.m_archetype = archetype;
+        def.m_row = firstRow + i;
+    }
+
+    for (size_t i = 0; i < prefab.types().size(); i++) {
+        uint32_t type = prefab.types()[i];
+
+        if (BaseECSComponent::getTypeStorage(type) == ComponentStorage::ARCHETYPE) {
+            cloneComponent(*archetype, static_cast<size_t>(archetype->columnIndex(type)), firstRow, count, prefab.value(i));
+            m_pool.countAdds(type, count);
+            continue;
+        }
+
+        SparseSet& set = findOrCreateSparseSet(type);
+        ECSCopyFunc_t copy = BaseECSComponent::getTypeCopyFunc(type);
+
+        for (Entity_t entity : range) {
+            void* memory = set.emplace(entity.m_index);
+            if (memory != nullptr) {
+                copy(memory, prefab.value(i));
+            }
+        }
+    }
+
+    return range;
 }
 
-Entity_t ECS::createEntity()
+void ECS::cloneComponent(Archetype& archetype, size_t column, uint32_t firstRow, uint32_t count, const BaseECSComponent* value)
+{
+    uint32_t type = archetype.types()[column];
+    size_t size = archetype.columnSize(column);
+    bool trivial = BaseECSComponent::isTriviallyCopyable(type);
+    ECSCopyFunc_t copy = BaseECSComponent::getTypeCopyFunc(type);
+
+    for (uint32_t row = firstRow; row < firstRow + count;) {
+        // rows of a chunk are contiguous within a column
+        uint32_t rows = std::min(archetype.chunkCapacity() - row % archetype.chunkCapacity(), firstRow + count - row);
+        uint8_t* first = static_cast<uint8_t*>(archetype.component(row, column));
+
+        if (trivial) {
+            // keep doubling the already cloned run, a handful of big memcpys per chunk
+            std::memcpy(first, value, size);
+
+            for (uint32_t cloned = 1; cloned < rows;) {
+                uint32_t batch = std::min(cloned, rows - cloned);
+                std::memcpy(first + cloned * size, first, batch * size);
+                cloned += batch;
+            }
+        } else {
+            for (uint32_t r = 0; r < rows; r++) {
+                copy(first + r * size, value);
+            }
+        }
+
+        row += rows;
+    }
+}
+
+bool ECS::removeEntity(Entity_t entity)
 {
-    size_t newEntityIndex = m_entities.size();
-    m_entities.emplace_back(newEntityIndex);
-    return &m_entities[newEntityIndex];
+    if (!isAlive(entity)) {
+        return false;
+    }
+
+    EntityDef& def = m_entities[entity.m_index];
+    m_structureVersion++;
+    recordDeparture(entity, def.m_archetype, nullptr);
+
+    for (uint32_t type : def.m_archetype->types()) {
+        m_pool.countRemoves(type, 1);
+    }
+
+    fixMovedEntity(def.m_archetype->removeRow(def.m_row, writeTick()), def.m_row);
+
+    for (auto& set : m_sparseSets) {
+        if (set != nullptr) {
+            set->remove(entity.m_index);
+        }
+    }
+
+    def.m_archetype = nullptr;
+    def.m_generation++;
+
+    if (def.m_generation == ECSCommandBuffer::PENDING_GENERATION) {
+        def.m_generation = 0;
+    }
+    m_freeList.push_back(entity.m_index);
+
+    return true;
 }
 
-void ECS::removeEntity(Entity_t entity)
+void* ECS::prepareComponent(EntityDef& entity, uint32_t index, uint32_t typeID)
 {
-    size_t lastIndex = m_entities.size() - 1;
+    if (BaseECSComponent::getTypeStorage(typeID) == ComponentStorage::SPARSE_SET) {
+        return findOrCreateSparseSet(typeID).emplace(index);
+    }
+
+    int32_t column = entity.m_archetype->columnIndex(typeID);
 
-    if (entity->m_index != lastIndex) {
-        m_entities[entity->m_index] = m_entities[lastIndex];
+    if (column >= 0) {
+        void* memory = entity.m_archetype->component(entity.m_row, static_cast<size_t>(column));
+        BaseECSComponent::getTypeFreeFunc(typeID)(reinterpret_cast<BaseECSComponent*>(memory));
+        entity.m_archetype->markChanged(entity.m_archetype->chunkOf(entity.m_row), static_cast<size_t>(column), writeTick());
+        return memory;
     }
 
-    m_entities.pop_back();
+    Archetype* target = addEdge(entity.m_archetype, typeID);
+    moveEntity(entity, index, target);
+
+    return target->component(entity.m_row, static_cast<size_t>(target->columnIndex(typeID)));
 }
 
-void ECS::updateSystems(const std::vector<ECSSystem*>& systemList, float delta)
+bool ECS::removeComponent(Entity_t entity, uint32_t typeID)
 {
-    for (auto system : systemList) {
-        system->setECS(this);
+    if (!isAlive(entity)) {
+        return false;
+    }
 
-        auto& types = system->types();
-        if (types.size() == 1) {
-            size_t typeSize = BaseECSComponent::getTypeSize(types[0]);
-            auto& componentMemory = m_components[types[0]];
+    if (BaseECSComponent::getTypeStorage(typeID) == ComponentStorage::SPARSE_SET) {
+        return typeID < m_sparseSets.size() && m_sparseSets[typeID] != nullptr && m_sparseSets[typeID]->remove(entity.m_index);
+    }
+
+    EntityDef& def = m_entities[entity.m_index];
+    if (def.m_archetype->columnIndex(typeID) < 0) {
+        return false;
+    }
 
-            for (size_t i = 0; i < componentMemory.size(); i += typeSize) {
-                BaseECSComponent* comp = reinterpret_cast<BaseECSComponent*>(&componentMemory[i]);
-                system->update(delta, comp->m_entity);
+    moveEntity(def, entity.m_index, removeEdge(def.m_archetype, typeID));
+    return true;
+}
+
+ComponentMask ECS::signature(Entity_t entity) const
+{
+    if (!isAlive(entity)) {
+        return ComponentMask{};
+    }
+
+    ComponentMask mask = m_entities[entity.m_index].m_archetype->mask();
+
+    for (auto& set : m_sparseSets) {
+        if (set != nullptr && set->contains(entity.m_index)) {
+            mask.set(set->typeID());
+        }
+    }
+
+    return mask;
+}
+
+SparseSet& ECS::findOrCreateSparseSet(uint32_t typeID)
+{
+    if (typeID >= m_sparseSets.size()) {
+        m_sparseSets.resize(typeID + 1);
+    }
+
+    if (m_sparseSets[typeID] == nullptr) {
+        m_sparseSets[typeID] = std::make_unique<SparseSet>(typeID, m_pool);
+    }
+
+    return *m_sparseSets[typeID];
+}
+
+Archetype* ECS::findOrCreateArchetype(std::vector<uint32_t> types)
+{
+    ComponentMask mask;
+    for (uint32_t type : types) {
+        mask.set(type);
+    }
+
+    auto it = m_archetypeLookup.find(mask);
+    if (it != m_archetypeLookup.end()) {
+        return it->second;
+    }
+
+    Archetype* archetype = m_archetypes.emplace_back(std::make_unique<Archetype>(std::move(types), m_pool)).get();
+    m_archetypeLookup.emplace(mask, archetype);
+
+    for (auto& entry : m_queries) {
+        entry.second->tryAdd(archetype);
+    }
+
+    return archetype;
+}
+
+std::vector<ComponentStats> ECS::componentStats() const
+{
+    std::vector<ComponentStats> stats(BaseECSComponent::getTypeCount());
+
+    for (uint32_t type = 0; type < stats.size(); type++) {
+        stats[type].m_typeID = type;
+        stats[type].m_name = BaseECSComponent::getTypeName(type);
+        stats[type].m_bytes = m_pool.usage(type);
+        stats[type].m_counters = m_pool.counters(type);
+    }
+
+    for (const auto& archetype : m_archetypes) {
+        for (uint32_t type : archetype->types()) {
+            stats[type].m_live += archetype->size();
+            stats[type].m_capacity += archetype->chunks().size() * archetype->chunkCapacity();
+        }
+    }
+
+    for (const auto& set : m_sparseSets) {
+        if (set != nullptr) {
+            stats[set->typeID()].m_live += set->size();
+            stats[set->typeID()].m_capacity += set->isTag() ? set->size() : set->pages().size() * set->elementsPerPage();
+        }
+    }
+
+    std::erase_if(stats, [](const ComponentStats& entry) {
+        return entry.m_counters.m_adds == 0 && entry.m_counters.m_allocations == 0;
+    });
+
+    return stats;
+}
+
+ECSQuery* ECS::query(const std::vector<uint32_t>& required)
+{
+    ComponentMask mask;
+    for (uint32_t type : required) {
+        mask.set(type);
+    }
+
+    return query(mask);
+}
+
+ECSQuery* ECS::query(const ComponentMask& required)
+{
+    auto it = m_queries.find(required);
+    if (it != m_queries.end()) {
+        return it->second.get();
+    }
+
+    auto newQuery = std::make_unique<ECSQuery>(required);
+    for (auto& archetype : m_archetypes) {
+        newQuery->tryAdd(archetype.get());
+    }
+
+    return m_queries.emplace(required, std::move(newQuery)).first->second.get();
+}
+
+Archetype* ECS::addEdge(Archetype* archetype, uint32_t typeID)
+{
+    auto it = archetype->m_addEdges.find(typeID);
+    if (it != archetype->m_addEdges.end()) {
+        return it->second;
+    }
+
+    std::vector<uint32_t> types = archetype->types();
+    types.insert(std::upper_bound(types.begin(), types.end(), typeID), typeID);
+
+    Archetype* target = findOrCreateArchetype(std::move(types));
+    archetype->m_addEdges[typeID] = target;
+    target->m_removeEdges[typeID] = archetype;
+
+    return target;
+}
+
+Archetype* ECS::removeEdge(Archetype* archetype, uint32_t typeID)
+{
+    auto it = archetype->m_removeEdges.find(typeID);
+    if (it != archetype->m_removeEdges.end()) {
+        return it->second;
+    }
+
+    std::vector<uint32_t> types = archetype->types();
+    types.erase(std::find(types.begin(), types.end(), typeID));
+
+    Archetype* target = findOrCreateArchetype(std::move(types));
+    archetype->m_removeEdges[typeID] = target;
+    target->m_addEdges[typeID] = archetype;
+
+    return target;
+}
+
+void ECS::moveEntity(EntityDef& entity, uint32_t index, Archetype* target)
+{
+    Archetype* source = entity.m_archetype;
+    m_structureVersion++;
+    recordDeparture(Entity_t{ index, entity.m_generation }, source, target);
+    uint32_t newRow = target->allocateRow(index, writeTick());
+
+    for (size_t i = 0; i < source->types().size(); i++) {
+        uint32_t type = source->types()[i];
+        BaseECSComponent* component = reinterpret_cast<BaseECSComponent*>(source->component(entity.m_row, i));
+        int32_t column = target->columnIndex(type);
+
+        if (column >= 0) {
+            BaseECSComponent::getTypeMoveFunc(type)(target->component(newRow, static_cast<size_t>(column)), component);
+        } else {
+            BaseECSComponent::getTypeFreeFunc(type)(component);
+            m_pool.countRemoves(type, 1);
+        }
+    }
+
+    for (uint32_t type : target->types()) {
+        if (source->columnIndex(type) < 0) {
+            m_pool.countAdds(type, 1);
+        }
+    }
+
+    fixMovedEntity(source->releaseRow(entity.m_row, writeTick()), entity.m_row);
+
+    entity.m_archetype = target;
+    entity.m_row = newRow;
+}
+
+void ECS::fixMovedEntity(uint32_t movedEntity, uint32_t row)
+{
+    if (movedEntity != Archetype::INVALID_ROW) {
+        m_entities[movedEntity].m_row = row;
+    }
+}
+
+void ECS::recordDeparture(Entity_t entity, const Archetype* source, const Archetype* target)
+{
+    for (ECSQuery* query : m_trackedQueries) {
+        if (!source->hasAll(query->m_required) || (target != nullptr && target->hasAll(query->m_required))) {
+            continue;
+        }
+
+        for (auto& log : query->m_departures) {
+            log->push_back(entity);
+        }
+    }
+}
+
+void ECS::playback(ECSCommandBuffer& buffer)
+{
+    PROFILE_ZONE("ECS::playback");
+
+    std::vector<Entity_t> created(buffer.m_pendingEntities);
+    for (auto& entity : created) {
+        entity = createEntity();
+    }
+
+    auto& commands = buffer.m_commands;
+
+    for (auto& command : commands) {
+        if (ECSCommandBuffer::isPending(command.m_entity)) {
+            command.m_entity = command.m_entity.m_index < created.size() ? created[command.m_entity.m_index] : NULL_ENTITY;
+        }
+    }
+
+    // stable, so every entity's commands keep their recording order
+    std::stable_sort(commands.begin(), commands.end(), [](const auto& a, const auto& b) {
+        return a.m_entity.m_index != b.m_entity.m_index ? a.m_entity.m_index < b.m_entity.m_index : a.m_entity.m_generation < b.m_entity.m_generation;
+    });
+
+    for (size_t first = 0; first < commands.size();) {
+        size_t last = first + 1;
+        while (last < commands.size() && commands[last].m_entity == commands[first].m_entity) {
+            last++;
+        }
+
+        applyCommands(commands.data() + first, commands.data() + last);
+        first = last;
+    }
+
+    buffer.clear();
+}
+
+void ECS::applyCommands(ECSCommandBuffer::Command* first, ECSCommandBuffer::Command* last)
+{
+    typedef ECSCommandBuffer::CommandType CommandType;
+
+    Entity_t entity = first->m_entity;
+    if (!isAlive(entity)) {
+        return;// leftover payloads get destroyed when the buffer is cleared
+    }
+
+    for (auto command = first; command != last; command++) {
+        if (command->m_type == CommandType::REMOVE_ENTITY) {
+            removeEntity(entity);
+            return;
+        }
+    }
+
+    EntityDef& def = m_entities[entity.m_index];
+    Archetype* source = def.m_archetype;
+    ComponentMask mask = source->mask();
+    std::vector<ECSCommandBuffer::Command*> adds;
+
+    // fold the commands into the final component set, the last add of a type wins
+    for (auto command = first; command != last; command++) {
+        if (BaseECSComponent::getTypeStorage(command->m_typeID) == ComponentStorage::SPARSE_SET) {// no archetype change, apply right away
+            if (command->m_type == CommandType::ADD_COMPONENT) {
+                void* memory = findOrCreateSparseSet(command->m_typeID).emplace(entity.m_index);
+                BaseECSComponent* payload = static_cast<BaseECSComponent*>(command->m_payload);
+
+                if (memory != nullptr) {
+                    BaseECSComponent::getTypeMoveFunc(command->m_typeID)(memory, payload);
+                } else {
+                    BaseECSComponent::getTypeFreeFunc(command->m_typeID)(payload);
+                }
+
+                command->m_payload = nullptr;
+            } else {
+                removeComponent(entity, command->m_typeID);
             }
+
+            continue;
+        }
+
+        auto previous = std::find_if(adds.begin(), adds.end(), [command](auto add) { return add->m_typeID == command->m_typeID; });
+
+        if (previous != adds.end()) {
+            BaseECSComponent::getTypeFreeFunc((*previous)->m_typeID)(static_cast<BaseECSComponent*>((*previous)->m_payload));
+            (*previous)->m_payload = nullptr;
+            adds.erase(previous);
+        }
+
+        if (command->m_type == CommandType::ADD_COMPONENT) {
+            mask.set(command->m_typeID);
+            adds.push_back(command);
         } else {
-            updateMultipleComponentSystem(system, delta, types);
+            mask.reset(command->m_typeID);
+        }
+    }
+
+    if (!(mask == source->mask())) {
+        std::vector<uint32_t> types;
+
+        for (uint32_t type : source->types()) {
+            if (mask.test(type)) {
+                types.push_back(type);
+            }
         }
+
+        for (auto add : adds) {
+            if (!source->mask().test(add->m_typeID)) {
+                types.push_back(add->m_typeID);
+            }
+        }
+
+        std::sort(types.begin(), types.end());
+        moveEntity(def, entity.m_index, findOrCreateArchetype(std::move(types)));
     }
+
+    for (auto add : adds) {
+        void* memory = def.m_archetype->component(def.m_row, static_cast<size_t>(def.m_archetype->columnIndex(add->m_typeID)));
+
+        if (source->mask().test(add->m_typeID)) {// replacing a value that survived the move
+            BaseECSComponent::getTypeFreeFunc(add->m_typeID)(static_cast<BaseECSComponent*>(memory));
+            def.m_archetype->markRowChanged(def.m_row, writeTick());
+        }
+
+        BaseECSComponent::getTypeMoveFunc(add->m_typeID)(memory, static_cast<BaseECSComponent*>(add->m_payload));
+        add->m_payload = nullptr;
+    }
+}
+
+void ECS::updateSystems(const std::vector<ECSSystem*>& systemList, float delta)
+{
+    for (auto system : systemList) {
+        updateSystem(system, delta);
+    }
+
+    playback(m_deferred);
 }
 
-void ECS::updateMultipleComponentSystem(ECSSystem* system, float delta, const std::vector<uint32_t>& types)
+ECSQuery* ECS::systemQuery(ECSSystem* system)
 {
+    if (system->m_parentECS == this && system->m_query != nullptr) {
+        return system->m_query;
+    }
+
+    const auto& types = system->types();
     const auto& flags = system->flags();
 
-    std::vector<uint32_t> nonOptionalTypes;
-    std::vector<Entity_t> validEntities;
+    ComponentMask nonOptionalTypes;
 
     for (size_t i = 0; i < flags.size(); i++) {
         if (flags[i] & ECSSystem::OPTIONAL_BIT) {
             continue;
         }
 
-        nonOptionalTypes.push_back(types[i]);
+        nonOptionalTypes.set(types[i]);
     }
 
-    for (auto& entity : m_entities) {
-        bool shouldAdd = true;
+    system->setECS(this);
+    system->m_query = query(nonOptionalTypes);
 
-        for (auto& type : nonOptionalTypes) {
-            bool invalid = true;
+    return system->m_query;
+}
 
-            for (auto& info : entity.m_infos) {
-                if (type == info.m_id) {
-                    invalid = false;
-                    break;
+std::vector<Entity_t>& ECS::trackDepartures(ECSQuery& query)
+{
+    if (query.m_departures.empty()) {
+        m_trackedQueries.push_back(&query);
+    }
+
+    return *query.m_departures.emplace_back(std::make_unique<std::vector<Entity_t>>());
+}
+
+void ECS::updateSystem(ECSSystem* system, float delta)
+{
+    PROFILE_ZONE(system->name());
+
+    ECSQuery* systemQuery = this->systemQuery(system);
+
+    beginSystemRun(system);
+    system->beginUpdate(delta);
+
+    if (system->needsUpdate()) {
+        if (systemQuery->hasSparse()) {
+            updateSystemSparse(system, delta, *systemQuery);
+        } else {
+            // every matching archetype is walked chunk by chunk, row by row
+            for (size_t a = 0; a < systemQuery->m_archetypes.size(); a++) {
+                Archetype& archetype = *systemQuery->m_archetypes[a];
+
+                for (size_t c = 0; c < archetype.chunks().size(); c++) {
+                    updateSystemChunk(system, delta, archetype, archetype.chunks()[c]);
                 }
             }
+        }
+    }
 
-            if (invalid) {
-                shouldAdd = false;
-                break;
-            }
+    endSystemRun(system);
+}
+
+void ECS::beginSystemRun(ECSSystem* system)
+{
+    system->m_runStart = std::chrono::steady_clock::now();
+    system->m_runTick = m_changeTick.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void ECS::endSystemRun(ECSSystem* system)
+{
+    system->m_lastRunTick = system->m_runTick;
+    system->m_lastRunTime = std::chrono::steady_clock::now() - system->m_runStart;
+    system->m_totalRunTime += system->m_lastRunTime;
+    system->m_runCount++;
+}
+
+void ECS::updateSystemChunk(ECSSystem* system, float delta, const Archetype& archetype, const ArchetypeChunk& chunk)
+{
+    system->updateChunk(delta, archetype, chunk);
+}
+
+void ECS::updateSystemSparse(ECSSystem* system, float delta, const ECSQuery& query)
+{
+    // walk the smallest required set, everything else is checked per entity
+    const SparseSet* smallest = nullptr;
+
+    for (uint32_t type : query.m_sparse) {
+        const SparseSet* set = sparseSet(type);
+        if (set == nullptr) {
+            return;// no entity has the type yet
         }
 
-        if (shouldAdd) {
-            validEntities.push_back(&entity);
+        if (smallest == nullptr || set->size() < smallest->size()) {
+            smallest = set;
         }
     }
 
-    for (auto& entity : validEntities) {
-        system->update(delta, entity);
+    if (smallest == nullptr) {
+        return;// only queries requiring sparse set types come through here
+    }
+
+    for (uint32_t index : smallest->entities()) {
+        if (!m_entities[index].m_archetype->hasAll(query.m_required)) {
+            continue;
+        }
+
+        bool matches = std::all_of(query.m_sparse.begin(), query.m_sparse.end(), [this, index](uint32_t type) {
+            return m_sparseSets[type]->contains(index);
+        });
+
+        if (matches) {
+            system->update(delta, handle(index));
+        }
     }
 }
@@ -16,94 +16,280 @@
 
 #pragma once
 
+#include "Archetype.hpp"
+#include "ComponentPool.hpp"
+#include "ECSCommandBuffer.hpp"
 #include "ECSComponent.hpp"
+#include "ECSPrefab.hpp"
+#include "ECSQuery.hpp"
+#include "EventBus.hpp"
+#include "SparseSet.hpp"
 
+#include <atomic>
 #include <cstddef>
 #include <unordered_map>
+#include <memory>
 #include <cstdint>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 class ECSSystem;
 
+template<typename... Components>
+class ECSView;
+
+struct EntityDef
+{
+    uint32_t m_generation = 0;
+
+    // where the entity's components live, nullptr while the slot is free
+    Archetype* m_archetype = nullptr;
+    uint32_t m_row = 0;
+};
+
+// one component type's storage at the time of ECS::componentStats
+struct ComponentStats
+{
+    uint32_t m_typeID = 0;
+    const char* m_name = nullptr;
+    size_t m_live = 0;// components currently stored
+    size_t m_capacity = 0;// components the type's chunks/pages can hold, the rest is slack
+    ComponentPool::Usage m_bytes;
+    ComponentPool::Counters m_counters;
+};
+
 class ECS
 {
   public:
+    ECS();
     ~ECS();
 
     // entities
     [[nodiscard]] Entity_t createEntity();
-    void removeEntity(Entity_t entity);
+    bool removeEntity(Entity_t entity);
 
-    // components
-    template<typename Component>
-    void addComponent(Entity_t entity, Component& component)
+    // count entities with a copy of every prefab component, in fresh consecutive slots.
+    // storage is reserved once and trivially copyable components are cloned with memcpy.
+    EntityRange createEntities(uint32_t count, const ECSPrefab& prefab);
+
+    // the current handle of the entity living in a slot, e.g. from an archetype's entity column
+    [[nodiscard]] inline Entity_t handle(uint32_t index) const
     {
-        auto& memory = m_components[Component::ID];
-        component.m_entity = entity;
-        entity->m_infos.push_back(copyComponent<Component>(memory, &component, memory.size()));
+        return Entity_t{ index, m_entities[index].m_generation };
     }
 
-    template<typename Component>
-    void addComponent(Entity_t entity, Component&& component)
+    [[nodiscard]] inline bool isAlive(Entity_t entity) const
     {
-        auto& memory = m_components[Component::ID];
-        component.m_entity = entity;
-        entity->m_infos.push_back(copyComponent<Component>(memory, &component, memory.size()));
+        return entity.m_index < m_entities.size() && m_entities[entity.m_index].m_generation == entity.m_generation && m_entities[entity.m_index].m_archetype != nullptr;
     }
 
-    template<typename Component>
-    bool removeComponent(Entity_t entity)
+    [[nodiscard]] inline const EntityDef& entity(uint32_t index) const
     {
-        for (uint32_t i = 0; i < entity->m_infos.size(); i++) {
-            auto& info = entity->m_infos[i];
-            if (Component::ID != info.m_id) {
-                continue;
-            }
+        return m_entities[index];
+    }
 
-            auto& memory = m_components[Component::ID];
-            size_t typeSize = Component::SIZE;
-            size_t lastComponentIndex = memory.size() - typeSize;
+    // number of entity slots, live or free
+    [[nodiscard]] inline uint32_t slotCount() const { return static_cast<uint32_t>(m_entities.size()); }
 
-            Component::FREE_FUNC(reinterpret_cast<BaseECSComponent*>(&memory[info.m_index]));// maybe unsafe ...
+    // bumped whenever an entity gets created, removed or changes archetype, i.e. whenever
+    // archetype rows may have moved
+    [[nodiscard]] constexpr uint64_t structureVersion() const { return m_structureVersion; }
 
-            if (info.m_index != lastComponentIndex) {
-                Component* lastComponent = reinterpret_cast<Component*>(&memory[lastComponentIndex]);
-                ComponentInfo newInfo = copyComponent<Component>(memory, lastComponent, info.m_index);
+    // components
+    template<typename Component>
+    bool addComponent(Entity_t entity, Component& component)
+    {
+        if (!isAlive(entity)) {
+            return false;
+        }
 
-                for (ComponentInfo& lastCompEntityinfo : lastComponent->m_entity->m_infos) {
-                    if (lastCompEntityinfo.m_id == newInfo.m_id) {
-                        lastCompEntityinfo.m_index = newInfo.m_index;
-                    }
-                }
-            }
+        void* memory = prepareComponent(m_entities[entity.m_index], entity.m_index, Component::ID);
+        if (memory != nullptr) {// sparse tags have no storage
+            new (memory) Component(component);
+        }
+
+        return true;
+    }
 
-            memory.resize(lastComponentIndex);
+    template<typename Component>
+    bool addComponent(Entity_t entity, Component&& component)
+    {
+        if (!isAlive(entity)) {
+            return false;
+        }
 
-            return true;
+        void* memory = prepareComponent(m_entities[entity.m_index], entity.m_index, Component::ID);
+        if (memory != nullptr) {// sparse tags have no storage
+            new (memory) Component(std::move(component));
         }
 
-        return false;
+        return true;
     }
 
     template<typename Component>
-    Component* get(Entity_t entity)
+    bool removeComponent(Entity_t entity)
     {
-        auto& memory = m_components[Component::ID];
-        for (auto& info : entity->m_infos) {
-            if (Component::ID == info.m_id) {
-                return reinterpret_cast<Component*>(&memory[info.m_index]);
-            }
+        return removeComponent(entity, Component::ID);
+    }
+
+    template<typename Component>
+    [[nodiscard]] bool has(Entity_t entity) const
+    {
+        if constexpr (Component::STORAGE == ComponentStorage::SPARSE_SET) {
+            const SparseSet* set = sparseSet(Component::ID);
+            return isAlive(entity) && set != nullptr && set->contains(entity.m_index);
+        } else {
+            return isAlive(entity) && m_entities[entity.m_index].m_archetype->mask().test(Component::ID);
         }
+    }
+
+    // the entity's current component set including sparse set types, empty for stale handles
+    [[nodiscard]] ComponentMask signature(Entity_t entity) const;
+
+    // get<const C> for read only access, anything else marks the component changed
+    template<typename Component>
+    Component* get(Entity_t entity)
+    {
+        return get<Component>(entity, writeTick());
+    }
 
-        return nullptr;
+    // storage of a SPARSE_SET component type, nullptr until the first entity gets one
+    [[nodiscard]] inline const SparseSet* sparseSet(uint32_t typeID) const
+    {
+        return typeID < m_sparseSets.size() ? m_sparseSets[typeID].get() : nullptr;
     }
 
+    // typed iteration, see ECSView.hpp
+    template<typename... Components>
+    [[nodiscard]] ECSView<Components...> view()
+    {
+        return ECSView<Components...>(*this, writeTick());
+    }
+
+    // Change ticks, see Archetype::version. Every system run takes a fresh tick and writes
+    // made outside of systems use the tick the next run will take, so every system sees
+    // them on its next run.
+    [[nodiscard]] inline uint32_t writeTick() const { return m_changeTick.load(std::memory_order_relaxed) + 1; }
+
+    // called around every system run, updateSystem does it on its own
+    void beginSystemRun(ECSSystem* system);
+    void endSystemRun(ECSSystem* system);
+
+    // queries are shared between every caller asking for the same set of required types
+    [[nodiscard]] ECSQuery* query(const std::vector<uint32_t>& required);
+    [[nodiscard]] ECSQuery* query(const ComponentMask& required);
+
+    // the query matching a system's non-optional types, resolved once per system
+    [[nodiscard]] ECSQuery* systemQuery(ECSSystem* system);
+
+    // Starts recording entities that leave the query's archetypes, removed or moved to one
+    // lacking a required type, and returns the log. Every caller gets a log of its own that
+    // lives as long as the scene, draining it is up to the caller. Sparse set types don't count.
+    [[nodiscard]] std::vector<Entity_t>& trackDepartures(ECSQuery& query);
+
+    // applies every recorded command in one pass sorted by entity and clears the buffer.
+    // must not run while systems iterate.
+    void playback(ECSCommandBuffer& buffer);
+
+    // buffer used by systems updated through updateSystems, played back once all of them ran
+    constexpr ECSCommandBuffer& deferred() { return m_deferred; }
+
     // systems
     void updateSystems(const std::vector<ECSSystem*>& systemList, float delta);
+    void updateSystem(ECSSystem* system, float delta);
+    void updateSystemChunk(ECSSystem* system, float delta, const Archetype& archetype, const ArchetypeChunk& chunk);
+
+    // per entity update for queries requiring sparse set types
+    void updateSystemSparse(ECSSystem* system, float delta, const ECSQuery& query);
+
+    // Binary snapshot of every entity and component, see ECSSnapshot.hpp. Only trivially
+    // copyable component types can be saved, loading needs a scene that never had entities.
+    // Entity handles stay valid across a save and load. Both return false on failure.
+    bool saveSnapshot(const std::string& path) const;
+    bool loadSnapshot(const std::string& path);
+
+    // events systems send each other, whoever drives the frame calls events().swap() at its end
+    constexpr EventBus& events() { return m_events; }
+
+    // every component type that ever had storage in this scene
+    [[nodiscard]] std::vector<ComponentStats> componentStats() const;
+
+    // memory behind every archetype chunk and sparse set, with per type usage
+    [[nodiscard]] constexpr const ComponentPool& pool() const { return m_pool; }
 
   private:
-    std::unordered_map<uint32_t, std::vector<uint8_t>> m_components;
+    ComponentPool m_pool;// declared first, the storages hand their pages back on destruction
+
+    std::vector<std::unique_ptr<Archetype>> m_archetypes;
+    std::unordered_map<ComponentMask, Archetype*, ComponentMask::Hasher> m_archetypeLookup;
+    Archetype* m_emptyArchetype;
+
+    std::unordered_map<ComponentMask, std::unique_ptr<ECSQuery>, ComponentMask::Hasher> m_queries;
+    std::vector<ECSQuery*> m_trackedQueries;// the ones with departure logs
+
+    std::vector<std::unique_ptr<SparseSet>> m_sparseSets;// indexed by type ID
+
+    // slot map, freed slots are recycled through m_freeList with a bumped generation
     std::vector<EntityDef> m_entities;
+    std::vector<uint32_t> m_freeList;
+
+    ECSCommandBuffer m_deferred;
+    EventBus m_events;
+
+    std::atomic<uint32_t> m_changeTick{ 0 };
+    uint64_t m_structureVersion = 0;
+
+    template<typename Component>
+    Component* get(Entity_t entity, uint32_t tick)
+    {
+        typedef std::remove_const_t<Component> Type;
+
+        if (!isAlive(entity)) {
+            return nullptr;
+        }
+
+        if constexpr (Type::STORAGE == ComponentStorage::SPARSE_SET) {
+            static_assert(!std::is_empty_v<Type>, "sparse tags carry no data, use has<>()");
+
+            const SparseSet* set = sparseSet(Type::ID);
+            return set != nullptr ? static_cast<Component*>(set->get(entity.m_index)) : nullptr;
+        } else {
+            const EntityDef& def = m_entities[entity.m_index];
+            int32_t column = def.m_archetype->columnIndex(Type::ID);
+            if (column < 0) {
+                return nullptr;
+            }
+
+            if constexpr (!std::is_const_v<Component>) {
+                def.m_archetype->markChanged(def.m_archetype->chunkOf(def.m_row), static_cast<size_t>(column), tick);
+            }
+
+            return static_cast<Component*>(def.m_archetype->component(def.m_row, static_cast<size_t>(column)));
+        }
+    }
+
+    // returns uninitialized (or destroyed, if the entity already had one) memory for the component
+    [[nodiscard]] void* prepareComponent(EntityDef& entity, uint32_t index, uint32_t typeID);
+    bool removeComponent(Entity_t entity, uint32_t typeID);
+    [[nodiscard]] SparseSet& findOrCreateSparseSet(uint32_t typeID);
+
+    [[nodiscard]] Archetype* findOrCreateArchetype(std::vector<uint32_t> types);
+    [[nodiscard]] Archetype* addEdge(Archetype* archetype, uint32_t typeID);
+    [[nodiscard]] Archetype* removeEdge(Archetype* archetype, uint32_t typeID);
+
+    // moves the entity's row into target, components missing from target are destroyed
+    void moveEntity(EntityDef& entity, uint32_t index, Archetype* target);
+    void fixMovedEntity(uint32_t movedEntity, uint32_t row);
+
+    // target is null for removed entities
+    void recordDeparture(Entity_t entity, const Archetype* source, const Archetype* target);
+
+    // copies value into count consecutive rows of a column
+    void cloneComponent(Archetype& archetype, size_t column, uint32_t firstRow, uint32_t count, const BaseECSComponent* value);
+
+    void applyCommands(ECSCommandBuffer::Command* first, ECSCommandBuffer::Command* last);
+
+    friend class ECSSystem;
 
-    void updateMultipleComponentSystem(ECSSystem* system, float delta, const std::vector<uint32_t>& types);
 };
@@ -0,0 +1,81 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "ECSCommandBuffer.hpp"
+
+#include <algorithm>
+
+ECSCommandBuffer::~ECSCommandBuffer()
+{
+    clear();
+
+    for (auto& block : m_blocks) {
+        ::operator delete(block.m_memory, std::align_val_t{ BLOCK_ALIGNMENT });
+    }
+}
+
+Entity_t ECSCommandBuffer::createEntity()
+{
+    return Entity_t{ m_pendingEntities++, PENDING_GENERATION };
+}
+
+void ECSCommandBuffer::removeEntity(Entity_t entity)
+{
+    record(CommandType::REMOVE_ENTITY, entity, 0, nullptr);
+}
+
+void ECSCommandBuffer::clear()
+{
+    for (auto& command : m_commands) {
+        if (command.m_payload != nullptr) {
+            BaseECSComponent::getTypeFreeFunc(command.m_typeID)(static_cast<BaseECSComponent*>(command.m_payload));
+        }
+    }
+
+    m_commands.clear();
+    m_pendingEntities = 0;
+
+    for (auto& block : m_blocks) {
+        block.m_used = 0;
+    }
+
+    m_currentBlock = 0;
+}
+
+void ECSCommandBuffer::record(CommandType type, Entity_t entity, uint32_t typeID, void* payload)
+{
+    m_commands.push_back(Command{ entity, typeID, type, payload });
+}
+
+void* ECSCommandBuffer::allocatePayload(size_t size, size_t alignment)
+{
+    for (; m_currentBlock < m_blocks.size(); m_currentBlock++) {
+        PayloadBlock& block = m_blocks[m_currentBlock];
+        size_t offset = (block.m_used + alignment - 1) & ~(alignment - 1);
+
+        if (offset + size <= block.m_size) {
+            block.m_used = offset + size;
+            return block.m_memory + offset;
+        }
+    }
+
+    size_t blockSize = std::max(BLOCK_SIZE, size);
+    uint8_t* memory = static_cast<uint8_t*>(::operator new(blockSize, std::align_val_t{ BLOCK_ALIGNMENT }));
+    m_blocks.push_back(PayloadBlock{ memory, blockSize, size });
+    m_currentBlock = m_blocks.size() - 1;
+
+    return memory;
+}
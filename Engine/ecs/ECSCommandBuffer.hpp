@@ -0,0 +1,115 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "ECSComponent.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+class ECS;
+
+// Records structural changes (entity creation/removal, component add/remove) so they can
+// be made while systems iterate. ECS::playback applies them later at a sync point.
+// A buffer is not thread safe, every thread records into its own.
+class ECSCommandBuffer
+{
+  public:
+    // generation used by handles of entities created inside a buffer, real entities never use it
+    static constexpr uint32_t PENDING_GENERATION = static_cast<uint32_t>(-1);
+
+    ECSCommandBuffer() = default;
+    ~ECSCommandBuffer();
+
+    ECSCommandBuffer(const ECSCommandBuffer&) = delete;
+    void operator=(const ECSCommandBuffer&) = delete;
+
+    // the returned handle is only meaningful to this buffer until it's played back
+    [[nodiscard]] Entity_t createEntity();
+    void removeEntity(Entity_t entity);
+
+    template<typename Component>
+    void addComponent(Entity_t entity, Component& component)
+    {
+        void* payload = allocatePayload(sizeof(Component), alignof(Component));
+        new (payload) Component(component);
+        record(CommandType::ADD_COMPONENT, entity, Component::ID, payload);
+    }
+
+    template<typename Component>
+    void addComponent(Entity_t entity, Component&& component)
+    {
+        void* payload = allocatePayload(sizeof(Component), alignof(Component));
+        new (payload) Component(std::move(component));
+        record(CommandType::ADD_COMPONENT, entity, Component::ID, payload);
+    }
+
+    template<typename Component>
+    void removeComponent(Entity_t entity)
+    {
+        record(CommandType::REMOVE_COMPONENT, entity, Component::ID, nullptr);
+    }
+
+    [[nodiscard]] constexpr bool empty() const { return m_commands.empty(); }
+    [[nodiscard]] constexpr size_t size() const { return m_commands.size(); }
+
+    // drops every recorded command without applying it
+    void clear();
+
+    [[nodiscard]] static constexpr bool isPending(Entity_t entity) { return entity.m_generation == PENDING_GENERATION; }
+
+  private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+    static constexpr size_t BLOCK_ALIGNMENT = 64;
+
+    enum class CommandType : uint8_t
+    {
+        REMOVE_ENTITY,
+        ADD_COMPONENT,
+        REMOVE_COMPONENT
+    };
+
+    struct Command
+    {
+        Entity_t m_entity;
+        uint32_t m_typeID;
+        CommandType m_type;
+        void* m_payload;// constructed component for ADD_COMPONENT, nullptr once consumed
+    };
+
+    struct PayloadBlock
+    {
+        uint8_t* m_memory;
+        size_t m_size;
+        size_t m_used;
+    };
+
+    std::vector<Command> m_commands;
+    uint32_t m_pendingEntities = 0;
+
+    // payloads never move once constructed, blocks are kept around between frames
+    std::vector<PayloadBlock> m_blocks;
+    size_t m_currentBlock = 0;
+
+    void record(CommandType type, Entity_t entity, uint32_t typeID, void* payload);
+    [[nodiscard]] void* allocatePayload(size_t size, size_t alignment);
+
+    friend class ECS;
+};
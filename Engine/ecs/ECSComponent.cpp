@@ -15,17 +15,24 @@
 */
 
 #include "ECSComponent.hpp"
+#include "ComponentMask.hpp"
+
 #include <memory>
+#include <stdexcept>
 
 std::unique_ptr<std::vector<TypeInfo>> BaseECSComponent::componentTypes;
 
-uint32_t BaseECSComponent::registerComponentType(ECSFreeFunc_t freeFunc, size_t size)
+uint32_t BaseECSComponent::registerComponentType(const TypeInfo& info)
 {
     if (componentTypes.get() == nullptr) {
         componentTypes = std::make_unique<std::vector<TypeInfo>>();
     }
 
+    if (componentTypes->size() >= ComponentMask::MAX_COMPONENT_TYPES) {
+        throw std::runtime_error("Too many component types, raise ComponentMask::MAX_COMPONENT_TYPES.");
+    }
+
     uint32_t newID = static_cast<uint32_t>(componentTypes->size());
-    componentTypes->emplace_back(freeFunc, size);
+    componentTypes->push_back(info);
     return newID;
 }
@@ -16,43 +16,100 @@
 
 #pragma once
 
+#include "ComponentPool.hpp"
+
 #include <cstddef>
 #include <cstdint>
 #include <vector>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+class BaseECSComponent;
 
-struct ComponentInfo
+// Generational handle into the ECS slot map. A handle goes stale once its entity
+// is removed, even if the slot gets reused by a newer entity.
+struct EntityHandle
 {
-    uint32_t m_id;
     uint32_t m_index;
+    uint32_t m_generation;
+
+    [[nodiscard]] constexpr bool operator==(const EntityHandle& other) const = default;
 };
 
-struct EntityDef
+typedef EntityHandle Entity_t;
+inline constexpr Entity_t NULL_ENTITY{ static_cast<uint32_t>(-1), 0 };
+
+// Entities occupying consecutive, never used slots, as returned by ECS::createEntities.
+// Fresh slots always start at generation 0.
+struct EntityRange
 {
-    uint32_t m_index;
-    std::vector<ComponentInfo> m_infos;
+    uint32_t m_first = 0;
+    uint32_t m_count = 0;
 
-    EntityDef(uint32_t index) : m_index(index) {}
+    struct Iterator
+    {
+        uint32_t m_index;
+
+        [[nodiscard]] constexpr Entity_t operator*() const { return Entity_t{ m_index, 0 }; }
+        constexpr Iterator& operator++()
+        {
+            m_index++;
+            return *this;
+        }
+        [[nodiscard]] constexpr bool operator==(const Iterator& other) const = default;
+    };
+
+    [[nodiscard]] constexpr uint32_t size() const { return m_count; }
+    [[nodiscard]] constexpr Entity_t operator[](uint32_t i) const { return Entity_t{ m_first + i, 0 }; }
+    [[nodiscard]] constexpr Iterator begin() const { return Iterator{ m_first }; }
+    [[nodiscard]] constexpr Iterator end() const { return Iterator{ m_first + m_count }; }
+};
+
+// ARCHETYPE components are part of the entity's archetype and iterate as dense columns.
+// SPARSE_SET components live in a per-type sparse set instead, adding or removing them
+// never moves the entity between archetypes. Meant for tags and frequently toggled state.
+enum class ComponentStorage : uint8_t
+{
+    ARCHETYPE,
+    SPARSE_SET
 };
 
-class BaseECSComponent;
-typedef EntityDef* Entity_t;
 typedef void (*ECSFreeFunc_t)(BaseECSComponent*);
+typedef void (*ECSMoveFunc_t)(void*, BaseECSComponent*);// move constructs into dst and destroys src
+typedef void (*ECSCopyFunc_t)(void*, const BaseECSComponent*);// copy constructs into dst, nullptr for move only types
 
 struct TypeInfo
 {
+    const char* m_name;// typeid name, stable between runs of the same build unlike the type ID
     ECSFreeFunc_t m_freefn;
+    ECSMoveFunc_t m_movefn;
+    ECSCopyFunc_t m_copyfn;
     size_t m_size;
+    size_t m_alignment;
+    ComponentStorage m_storage;
+    bool m_tag;// empty type, carries no data
+    bool m_trivial;// trivially copyable, copies may be plain memcpys
 
-    TypeInfo(ECSFreeFunc_t freefn, size_t size) : m_freefn(freefn), m_size(size) {}
+    TypeInfo(const char* name, ECSFreeFunc_t freefn, ECSMoveFunc_t movefn, ECSCopyFunc_t copyfn, size_t size, size_t alignment, ComponentStorage storage, bool tag, bool trivial)
+        : m_name(name), m_freefn(freefn), m_movefn(movefn), m_copyfn(copyfn), m_size(size), m_alignment(alignment), m_storage(storage), m_tag(tag), m_trivial(trivial) {}
 };
 
 class BaseECSComponent
 {
   public:
-    Entity_t m_entity;
+    [[nodiscard]] static uint32_t registerComponentType(const TypeInfo& info);
+
+    [[nodiscard]] inline static const char* getTypeName(uint32_t id)
+    {
+        if (componentTypes.get() == nullptr || !validateType(id)) {
+            return nullptr;
+        }
 
-    [[nodiscard]] static uint32_t registerComponentType(ECSFreeFunc_t freeFunc, size_t size);
+        return componentTypes->at(id).m_name;
+    }
 
     [[nodiscard]] inline static ECSFreeFunc_t getTypeFreeFunc(uint32_t id)
     {
@@ -63,6 +120,33 @@ class BaseECSComponent
         return componentTypes->at(id).m_freefn;
     }
 
+    [[nodiscard]] inline static ECSMoveFunc_t getTypeMoveFunc(uint32_t id)
+    {
+        if (componentTypes.get() == nullptr || !validateType(id)) {
+            return 0;
+        }
+
+        return componentTypes->at(id).m_movefn;
+    }
+
+    [[nodiscard]] inline static ECSCopyFunc_t getTypeCopyFunc(uint32_t id)
+    {
+        if (componentTypes.get() == nullptr || !validateType(id)) {
+            return 0;
+        }
+
+        return componentTypes->at(id).m_copyfn;
+    }
+
+    [[nodiscard]] inline static bool isTriviallyCopyable(uint32_t id)
+    {
+        if (componentTypes.get() == nullptr || !validateType(id)) {
+            return false;
+        }
+
+        return componentTypes->at(id).m_trivial;
+    }
+
     [[nodiscard]] inline static size_t getTypeSize(uint32_t id)
     {
         if (componentTypes.get() == nullptr || !validateType(id)) {
@@ -72,6 +156,38 @@ class BaseECSComponent
         return componentTypes->at(id).m_size;
     }
 
+    [[nodiscard]] inline static size_t getTypeAlignment(uint32_t id)
+    {
+        if (componentTypes.get() == nullptr || !validateType(id)) {
+            return 0;
+        }
+
+        return componentTypes->at(id).m_alignment;
+    }
+
+    [[nodiscard]] inline static ComponentStorage getTypeStorage(uint32_t id)
+    {
+        if (componentTypes.get() == nullptr || !validateType(id)) {
+            return ComponentStorage::ARCHETYPE;
+        }
+
+        return componentTypes->at(id).m_storage;
+    }
+
+    [[nodiscard]] inline static bool isTagType(uint32_t id)
+    {
+        if (componentTypes.get() == nullptr || !validateType(id)) {
+            return false;
+        }
+
+        return componentTypes->at(id).m_tag;
+    }
+
+    [[nodiscard]] inline static uint32_t getTypeCount()
+    {
+        return componentTypes.get() == nullptr ? 0 : static_cast<uint32_t>(componentTypes->size());
+    }
+
     [[nodiscard]] inline static bool validateType(uint32_t id)
     {
         if (componentTypes.get() == nullptr) {
@@ -85,33 +201,60 @@ class BaseECSComponent
     static std::unique_ptr<std::vector<TypeInfo>> componentTypes;
 };
 
-template<typename T>
+template<typename T, ComponentStorage Storage = ComponentStorage::ARCHETYPE>
 struct ECSComponent : public BaseECSComponent
 {
+    static constexpr ComponentStorage STORAGE = Storage;
+
     static const ECSFreeFunc_t FREE_FUNC;
     static const uint32_t ID;
     static const size_t SIZE;
 };
 
 template<typename Component>
-[[nodiscard]] ComponentInfo copyComponent(std::vector<uint8_t>& memory, Component* component, size_t index)
+void destroyComponent(BaseECSComponent* component)
 {
-    memory.resize(index + Component::SIZE);
-    new (&memory[index]) Component(*component);
-    return ComponentInfo{ Component::ID, static_cast<uint32_t>(index) };
+    reinterpret_cast<Component*>(component)->~Component();
 }
 
 template<typename Component>
-void destroyComponent(BaseECSComponent* component)
+void moveComponent(void* dst, BaseECSComponent* src)
 {
-    reinterpret_cast<Component*>(component)->~Component();
+    Component* source = reinterpret_cast<Component*>(src);
+    new (dst) Component(std::move(*source));
+    source->~Component();
+}
+
+template<typename Component>
+void copyComponent(void* dst, const BaseECSComponent* src)
+{
+    new (dst) Component(*reinterpret_cast<const Component*>(src));
+}
+
+template<typename Component>
+[[nodiscard]] constexpr ECSCopyFunc_t copyFunction()
+{
+    if constexpr (std::is_copy_constructible_v<Component>) {
+        return &copyComponent<Component>;
+    } else {
+        return nullptr;
+    }
 }
 
-template<typename T>
-const ECSFreeFunc_t ECSComponent<T>::FREE_FUNC{ &destroyComponent<T> };
+template<typename T, ComponentStorage Storage>
+const ECSFreeFunc_t ECSComponent<T, Storage>::FREE_FUNC{ &destroyComponent<T> };
+
+template<typename T, ComponentStorage Storage>
+[[nodiscard]] TypeInfo componentTypeInfo()
+{
+    // chunk columns and sparse set pages are only ever aligned this far
+    static_assert(alignof(T) <= ComponentPool::ALIGNMENT, "component alignment exceeds ComponentPool::ALIGNMENT");
+
+    return TypeInfo{ typeid(T).name(), &destroyComponent<T>, &moveComponent<T>, copyFunction<T>(), sizeof(T), alignof(T), Storage, std::is_empty_v<T>, std::is_trivially_copyable_v<T> };
+}
 
-template<typename T>
-const uint32_t ECSComponent<T>::ID{ BaseECSComponent::registerComponentType(&destroyComponent<T>, sizeof(T)) };
+template<typename T, ComponentStorage Storage>
+const uint32_t ECSComponent<T, Storage>::ID{ BaseECSComponent::registerComponentType(componentTypeInfo<T, Storage>()) };
 
-template<typename T>
-const size_t ECSComponent<T>::SIZE{ sizeof(T) };
+template<typename T, ComponentStorage Storage>
+const size_t ECSComponent<T, Storage>::SIZE{ sizeof(T) };
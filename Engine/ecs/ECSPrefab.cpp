@@ -0,0 +1,45 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "ECSPrefab.hpp"
+
+#include <algorithm>
+#include <new>
+
+ECSPrefab::~ECSPrefab()
+{
+    for (size_t i = 0; i < m_types.size(); i++) {
+        BaseECSComponent::getTypeFreeFunc(m_types[i])(static_cast<BaseECSComponent*>(m_values[i]));
+        ::operator delete(m_values[i], std::align_val_t{ BaseECSComponent::getTypeAlignment(m_types[i]) });
+    }
+}
+
+void* ECSPrefab::prepareComponent(uint32_t typeID)
+{
+    auto it = std::lower_bound(m_types.begin(), m_types.end(), typeID);
+    size_t index = static_cast<size_t>(it - m_types.begin());
+
+    if (it != m_types.end() && *it == typeID) {
+        BaseECSComponent::getTypeFreeFunc(typeID)(static_cast<BaseECSComponent*>(m_values[index]));
+        return m_values[index];
+    }
+
+    void* memory = ::operator new(BaseECSComponent::getTypeSize(typeID), std::align_val_t{ BaseECSComponent::getTypeAlignment(typeID) });
+    m_types.insert(it, typeID);
+    m_values.insert(m_values.begin() + static_cast<std::ptrdiff_t>(index), memory);
+
+    return memory;
+}
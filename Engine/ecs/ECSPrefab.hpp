@@ -0,0 +1,56 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "ECSComponent.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Component values stamped onto every entity made by ECS::createEntities. Trivially
+// copyable components get cloned with memcpy, everything else through its copy constructor.
+class ECSPrefab
+{
+  public:
+    ECSPrefab() = default;
+    ~ECSPrefab();
+
+    ECSPrefab(const ECSPrefab&) = delete;
+    void operator=(const ECSPrefab&) = delete;
+
+    // replaces the value if the prefab already has the type
+    template<typename Component>
+    ECSPrefab& add(const Component& component)
+    {
+        static_assert(std::is_copy_constructible_v<Component>, "prefab components get copied onto every instance");
+
+        new (prepareComponent(Component::ID)) Component(component);
+        return *this;
+    }
+
+    // sorted by type ID, value(i) belongs to types()[i]
+    [[nodiscard]] constexpr const std::vector<uint32_t>& types() const { return m_types; }
+    [[nodiscard]] inline const BaseECSComponent* value(size_t index) const { return static_cast<const BaseECSComponent*>(m_values[index]); }
+
+  private:
+    std::vector<uint32_t> m_types;
+    std::vector<void*> m_values;
+
+    // uninitialized memory for the type's value
+    [[nodiscard]] void* prepareComponent(uint32_t typeID);
+};
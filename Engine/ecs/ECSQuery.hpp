@@ -0,0 +1,57 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "Archetype.hpp"
+#include "ComponentMask.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Cached list of archetypes containing every required component type. The ECS
+// appends new archetypes as they get created, so iterating never rescans the world.
+// Required sparse set types can't be matched per archetype, they're kept aside and
+// checked per entity.
+struct ECSQuery
+{
+    ComponentMask m_required;// archetype stored types only
+    std::vector<uint32_t> m_sparse;
+    std::vector<Archetype*> m_archetypes;
+
+    // one log per ECS::trackDepartures caller
+    std::vector<std::unique_ptr<std::vector<Entity_t>>> m_departures;
+
+    explicit ECSQuery(const ComponentMask& required) : m_required(required)
+    {
+        for (uint32_t type = 0; type < BaseECSComponent::getTypeCount(); type++) {
+            if (required.test(type) && BaseECSComponent::getTypeStorage(type) == ComponentStorage::SPARSE_SET) {
+                m_required.reset(type);
+                m_sparse.push_back(type);
+            }
+        }
+    }
+
+    [[nodiscard]] inline bool hasSparse() const { return !m_sparse.empty(); }
+
+    inline void tryAdd(Archetype* archetype)
+    {
+        if (archetype->hasAll(m_required)) {
+            m_archetypes.push_back(archetype);
+        }
+    }
+};
@@ -0,0 +1,569 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "ECS.hpp"
+#include "ECSSnapshot.hpp"
+#include "../profiling/Profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static constexpr size_t WRITE_BUFFER_SIZE = 1 << 20;
+static constexpr uint32_t INVALID_TYPE = static_cast<uint32_t>(-1);
+
+static constexpr size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// buffered sequential writes, sections get padded to SNAPSHOT_ALIGNMENT
+class SnapshotWriter
+{
+  public:
+    explicit SnapshotWriter(const std::string& path) : m_buffer(std::make_unique<char[]>(WRITE_BUFFER_SIZE)), m_file(std::fopen(path.c_str(), "wb"))
+    {
+        if (m_file != nullptr) {
+            std::setvbuf(m_file, m_buffer.get(), _IOFBF, WRITE_BUFFER_SIZE);
+        }
+    }
+
+    ~SnapshotWriter()
+    {
+        if (m_file != nullptr) {
+            std::fclose(m_file);
+        }
+    }
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    void operator=(const SnapshotWriter&) = delete;
+
+    [[nodiscard]] constexpr bool isOpen() const { return m_file != nullptr; }
+
+    void write(const void* data, size_t bytes)
+    {
+        if (bytes > 0 && m_good) {
+            m_good = std::fwrite(data, 1, bytes, m_file) == bytes;
+        }
+
+        m_offset += bytes;
+    }
+
+    void align()
+    {
+        static constexpr uint8_t ZEROS[SNAPSHOT_ALIGNMENT]{};
+        write(ZEROS, alignUp(m_offset, SNAPSHOT_ALIGNMENT) - m_offset);
+    }
+
+    // flushes and closes the file, false if any write failed
+    [[nodiscard]] bool finish()
+    {
+        bool good = std::fclose(m_file) == 0 && m_good;
+        m_file = nullptr;
+        return good;
+    }
+
+  private:
+    std::unique_ptr<char[]> m_buffer;
+    std::FILE* m_file;
+    size_t m_offset = 0;
+    bool m_good = true;
+};
+
+// read only view of a whole file, data() is nullptr if it couldn't be mapped
+class MappedFile
+{
+  public:
+    explicit MappedFile(const std::string& path)
+    {
+#ifdef _WIN32
+        m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        LARGE_INTEGER size;
+
+        if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &size) || size.QuadPart == 0) {
+            return;
+        }
+
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping == nullptr) {
+            return;
+        }
+
+        m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        m_size = static_cast<size_t>(size.QuadPart);
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat info;
+
+        if (fd < 0) {
+            return;
+        }
+
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* memory = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (memory != MAP_FAILED) {
+                madvise(memory, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+                m_data = static_cast<const uint8_t*>(memory);
+                m_size = static_cast<size_t>(info.st_size);
+            }
+        }
+
+        close(fd);// the mapping keeps the file alive
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (m_data != nullptr) {
+            UnmapViewOfFile(m_data);
+        }
+
+        if (m_mapping != nullptr) {
+            CloseHandle(m_mapping);
+        }
+
+        if (m_file != INVALID_HANDLE_VALUE) {
+            CloseHandle(m_file);
+        }
+#else
+        if (m_data != nullptr) {
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    void operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] constexpr const uint8_t* data() const { return m_data; }
+    [[nodiscard]] constexpr size_t size() const { return m_size; }
+
+  private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#endif
+};
+
+// bounds checked reads straight out of the mapping
+class SnapshotReader
+{
+  public:
+    SnapshotReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    // count values at the current offset, nullptr if the file is too short
+    template<typename T>
+    [[nodiscard]] const T* read(size_t count = 1)
+    {
+        if (count > (m_size - m_offset) / sizeof(T)) {
+            return nullptr;
+        }
+
+        const T* values = static_cast<const T*>(static_cast<const void*>(m_data + m_offset));
+        m_offset += count * sizeof(T);
+        return values;
+    }
+
+    void align()
+    {
+        m_offset = std::min(alignUp(m_offset, SNAPSHOT_ALIGNMENT), m_size);
+    }
+
+  private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_offset = 0;
+};
+
+// copies count tightly packed values into consecutive rows of an archetype column
+static void fillColumn(Archetype& archetype, size_t column, uint32_t firstRow, uint32_t count, const uint8_t* values)
+{
+    size_t size = archetype.columnSize(column);
+    uint32_t lastRow = firstRow + count;
+
+    for (uint32_t row = firstRow; row < lastRow;) {
+        uint32_t chunkRow = row % archetype.chunkCapacity();
+        uint32_t rows = std::min(archetype.chunkCapacity() - chunkRow, lastRow - row);
+
+        std::memcpy(archetype.column(archetype.chunkOf(row), column) + chunkRow * size, values + (row - firstRow) * size, rows * size);
+        row += rows;
+    }
+}
+
+bool ECS::saveSnapshot(const std::string& path) const
+{
+    PROFILE_ZONE("ECS::saveSnapshot");
+
+    // only types something actually holds end up in the type table
+    std::vector<uint32_t> types;
+    std::vector<uint32_t> typeIndices(BaseECSComponent::getTypeCount(), INVALID_TYPE);
+    bool savable = true;
+
+    auto addType = [&](uint32_t type) {
+        if (typeIndices[type] == INVALID_TYPE) {
+            typeIndices[type] = static_cast<uint32_t>(types.size());
+            types.push_back(type);
+            savable &= BaseECSComponent::isTriviallyCopyable(type);
+        }
+    };
+
+    std::vector<const Archetype*> archetypes;
+    for (const auto& archetype : m_archetypes) {
+        if (archetype->size() > 0) {
+            archetypes.push_back(archetype.get());
+            std::for_each(archetype->types().begin(), archetype->types().end(), addType);
+        }
+    }
+
+    std::vector<const SparseSet*> sparseSets;
+    for (const auto& set : m_sparseSets) {
+        if (set != nullptr && set->size() > 0) {
+            sparseSets.push_back(set.get());
+            addType(set->typeID());
+        }
+    }
+
+    if (!savable) {
+        return false;
+    }
+
+    SnapshotWriter writer(path);
+    if (!writer.isOpen()) {
+        return false;
+    }
+
+    SnapshotHeader header{ SNAPSHOT_MAGIC, SNAPSHOT_VERSION, static_cast<uint32_t>(types.size()), static_cast<uint32_t>(archetypes.size()), static_cast<uint32_t>(sparseSets.size()), slotCount(), static_cast<uint32_t>(m_freeList.size()), 0 };
+    writer.write(&header, sizeof(header));
+    writer.align();
+
+    for (uint32_t type : types) {
+        const char* name = BaseECSComponent::getTypeName(type);
+        SnapshotType record{ static_cast<uint32_t>(BaseECSComponent::getTypeSize(type)), static_cast<uint32_t>(BaseECSComponent::getTypeAlignment(type)), static_cast<uint32_t>(BaseECSComponent::getTypeStorage(type)), static_cast<uint32_t>(std::strlen(name)) };
+
+        writer.write(&record, sizeof(record));
+        writer.write(name, record.m_nameLength);
+        writer.align();
+    }
+
+    std::vector<uint32_t> generations(m_entities.size());
+    for (size_t i = 0; i < m_entities.size(); i++) {
+        generations[i] = m_entities[i].m_generation;
+    }
+
+    writer.write(generations.data(), generations.size() * sizeof(uint32_t));
+    writer.write(m_freeList.data(), m_freeList.size() * sizeof(uint32_t));
+    writer.align();
+
+    std::vector<uint32_t> archetypeTypes;
+    for (const Archetype* archetype : archetypes) {
+        SnapshotArchetype record{ static_cast<uint32_t>(archetype->types().size()), archetype->size() };
+
+        archetypeTypes.clear();
+        for (uint32_t type : archetype->types()) {
+            archetypeTypes.push_back(typeIndices[type]);
+        }
+
+        writer.write(&record, sizeof(record));
+        writer.write(archetypeTypes.data(), archetypeTypes.size() * sizeof(uint32_t));
+        writer.align();
+
+        for (const ArchetypeChunk& chunk : archetype->chunks()) {
+            writer.write(archetype->entities(chunk), chunk.m_count * sizeof(uint32_t));
+        }
+        writer.align();
+
+        for (size_t column = 0; column < archetype->types().size(); column++) {
+            for (const ArchetypeChunk& chunk : archetype->chunks()) {
+                writer.write(archetype->column(chunk, column), chunk.m_count * archetype->columnSize(column));
+            }
+            writer.align();
+        }
+    }
+
+    for (const SparseSet* set : sparseSets) {
+        SnapshotSparseSet record{ typeIndices[set->typeID()], set->size() };
+
+        writer.write(&record, sizeof(record));
+        writer.write(set->entities().data(), set->size() * sizeof(uint32_t));
+        writer.align();
+
+        if (set->isTag()) {
+            continue;
+        }
+
+        size_t elementSize = BaseECSComponent::getTypeSize(set->typeID());
+        for (uint32_t first = 0; first < set->size(); first += set->elementsPerPage()) {
+            uint32_t count = std::min(set->elementsPerPage(), set->size() - first);
+            writer.write(set->pages()[first / set->elementsPerPage()], count * elementSize);
+        }
+        writer.align();
+    }
+
+    return writer.finish();
+}
+
+bool ECS::loadSnapshot(const std::string& path)
+{
+    PROFILE_ZONE("ECS::loadSnapshot");
+
+    if (!m_entities.empty()) {
+        return false;
+    }
+
+    MappedFile file(path);
+    if (file.data() == nullptr) {
+        return false;
+    }
+
+    SnapshotReader reader(file.data(), file.size());
+
+    const SnapshotHeader* header = reader.read<SnapshotHeader>();
+    reader.align();
+
+    if (header == nullptr || header->m_magic != SNAPSHOT_MAGIC || header->m_version != SNAPSHOT_VERSION) {
+        return false;
+    }
+
+    // map the snapshot's type table onto this build's type IDs
+    std::unordered_map<std::string_view, uint32_t> typesByName;
+    for (uint32_t type = 0; type < BaseECSComponent::getTypeCount(); type++) {
+        typesByName.emplace(BaseECSComponent::getTypeName(type), type);
+    }
+
+    // every type at most once, the blocks below rely on it
+    std::vector<uint32_t> types(header->m_typeCount);
+    ComponentMask seenTypes;
+
+    for (uint32_t& type : types) {
+        const SnapshotType* record = reader.read<SnapshotType>();
+        const char* name = record != nullptr ? reader.read<char>(record->m_nameLength) : nullptr;
+        reader.align();
+
+        if (name == nullptr) {
+            return false;
+        }
+
+        auto it = typesByName.find(std::string_view(name, record->m_nameLength));
+        if (it == typesByName.end() || seenTypes.test(it->second)) {
+            return false;
+        }
+
+        type = it->second;
+        seenTypes.set(type);
+
+        bool matches = BaseECSComponent::getTypeSize(type) == record->m_size
+                       && BaseECSComponent::getTypeAlignment(type) == record->m_alignment
+                       && static_cast<uint32_t>(BaseECSComponent::getTypeStorage(type)) == record->m_storage
+                       && BaseECSComponent::isTriviallyCopyable(type);
+
+        if (!matches) {
+            return false;
+        }
+    }
+
+    const uint32_t* generations = reader.read<uint32_t>(header->m_slotCount);
+    const uint32_t* freeList = reader.read<uint32_t>(header->m_freeCount);
+    reader.align();
+
+    if (generations == nullptr || freeList == nullptr) {
+        return false;
+    }
+
+    // everything gets validated before the scene is touched. every slot has to be either
+    // free or live in exactly one archetype.
+    std::vector<uint8_t> slotUsed(header->m_slotCount, 0);
+
+    for (uint32_t i = 0; i < header->m_freeCount; i++) {
+        if (freeList[i] >= header->m_slotCount || slotUsed[freeList[i]] != 0) {
+            return false;
+        }
+        slotUsed[freeList[i]] = 1;
+    }
+
+    struct ArchetypeBlock
+    {
+        std::vector<uint32_t> m_types;
+        uint32_t m_rowCount;
+        const uint32_t* m_entities;
+        std::vector<const uint8_t*> m_columns;
+    };
+
+    std::vector<ArchetypeBlock> archetypeBlocks(header->m_archetypeCount);
+
+    for (ArchetypeBlock& block : archetypeBlocks) {
+        const SnapshotArchetype* record = reader.read<SnapshotArchetype>();
+        const uint32_t* typeIndices = record != nullptr ? reader.read<uint32_t>(record->m_typeCount) : nullptr;
+        reader.align();
+
+        if (typeIndices == nullptr) {
+            return false;
+        }
+
+        ComponentMask mask;
+        for (uint32_t i = 0; i < record->m_typeCount; i++) {
+            if (typeIndices[i] >= types.size() || mask.test(types[typeIndices[i]]) || BaseECSComponent::getTypeStorage(types[typeIndices[i]]) != ComponentStorage::ARCHETYPE) {
+                return false;
+            }
+
+            mask.set(types[typeIndices[i]]);
+            block.m_types.push_back(types[typeIndices[i]]);
+        }
+
+        block.m_rowCount = record->m_rowCount;
+        block.m_entities = reader.read<uint32_t>(block.m_rowCount);
+        reader.align();
+
+        if (block.m_entities == nullptr) {
+            return false;
+        }
+
+        for (uint32_t row = 0; row < block.m_rowCount; row++) {
+            uint32_t entity = block.m_entities[row];
+            if (entity >= header->m_slotCount || slotUsed[entity] != 0) {
+                return false;
+            }
+            slotUsed[entity] = 2;
+        }
+
+        for (uint32_t type : block.m_types) {
+            block.m_columns.push_back(reader.read<uint8_t>(static_cast<size_t>(block.m_rowCount) * BaseECSComponent::getTypeSize(type)));
+            reader.align();
+
+            if (block.m_columns.back() == nullptr) {
+                return false;
+            }
+        }
+    }
+
+    // a slot in neither would be live without an archetype. pending generations are reserved
+    // for command buffer handles and would make the loaded entity look pending.
+    for (uint32_t i = 0; i < header->m_slotCount; i++) {
+        if (slotUsed[i] == 0 || generations[i] == ECSCommandBuffer::PENDING_GENERATION) {
+            return false;
+        }
+    }
+
+    struct SparseSetBlock
+    {
+        uint32_t m_type;
+        uint32_t m_count;
+        const uint32_t* m_entities;
+        const uint8_t* m_values;
+    };
+
+    std::vector<SparseSetBlock> sparseSetBlocks(header->m_sparseSetCount);
+    std::vector<uint32_t> lastSet(header->m_slotCount, INVALID_TYPE);
+    ComponentMask sparseTypes;// one block per type, each one gets copied in from the first page
+
+    for (SparseSetBlock& block : sparseSetBlocks) {
+        const SnapshotSparseSet* record = reader.read<SnapshotSparseSet>();
+        const uint32_t* entities = record != nullptr ? reader.read<uint32_t>(record->m_count) : nullptr;
+        reader.align();
+
+        if (entities == nullptr || record->m_type >= types.size() || BaseECSComponent::getTypeStorage(types[record->m_type]) != ComponentStorage::SPARSE_SET || sparseTypes.test(types[record->m_type])) {
+            return false;
+        }
+
+        sparseTypes.set(types[record->m_type]);
+
+        block = SparseSetBlock{ types[record->m_type], record->m_count, entities, nullptr };
+
+        for (uint32_t i = 0; i < block.m_count; i++) {
+            if (entities[i] >= header->m_slotCount || slotUsed[entities[i]] != 2 || lastSet[entities[i]] == block.m_type) {
+                return false;
+            }
+            lastSet[entities[i]] = block.m_type;
+        }
+
+        if (!BaseECSComponent::isTagType(block.m_type)) {
+            block.m_values = reader.read<uint8_t>(static_cast<size_t>(block.m_count) * BaseECSComponent::getTypeSize(block.m_type));
+            reader.align();
+
+            if (block.m_values == nullptr) {
+                return false;
+            }
+        }
+    }
+
+    // the snapshot is sound, bulk copy it in
+    uint32_t tick = writeTick();
+    m_structureVersion++;
+
+    m_entities.resize(header->m_slotCount);
+    for (uint32_t i = 0; i < header->m_slotCount; i++) {
+        m_entities[i].m_generation = generations[i];
+    }
+
+    m_freeList.assign(freeList, freeList + header->m_freeCount);
+
+    for (ArchetypeBlock& block : archetypeBlocks) {
+        std::vector<uint32_t> sortedTypes = block.m_types;
+        std::sort(sortedTypes.begin(), sortedTypes.end());
+
+        Archetype* archetype = findOrCreateArchetype(std::move(sortedTypes));
+        uint32_t firstRow = archetype->allocateRows(block.m_entities, block.m_rowCount, tick);
+
+        for (uint32_t row = 0; row < block.m_rowCount; row++) {
+            EntityDef& def = m_entities[block.m_entities[row]];
+            def.m_archetype = archetype;
+            def.m_row = firstRow + row;
+        }
+
+        for (size_t i = 0; i < block.m_types.size(); i++) {
+            fillColumn(*archetype, static_cast<size_t>(archetype->columnIndex(block.m_types[i])), firstRow, block.m_rowCount, block.m_columns[i]);
+            m_pool.countAdds(block.m_types[i], block.m_rowCount);
+        }
+    }
+
+    for (const SparseSetBlock& block : sparseSetBlocks) {
+        SparseSet& set = findOrCreateSparseSet(block.m_type);
+
+        for (uint32_t i = 0; i < block.m_count; i++) {
+            static_cast<void>(set.emplace(block.m_entities[i]));
+        }
+
+        if (set.isTag()) {
+            continue;
+        }
+
+        size_t elementSize = BaseECSComponent::getTypeSize(block.m_type);
+        for (uint32_t first = 0; first < block.m_count; first += set.elementsPerPage()) {
+            uint32_t count = std::min(set.elementsPerPage(), block.m_count - first);
+            std::memcpy(set.pages()[first / set.elementsPerPage()], block.m_values + first * elementSize, count * elementSize);
+        }
+    }
+
+    return true;
+}
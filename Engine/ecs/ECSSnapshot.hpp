@@ -0,0 +1,71 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// File layout of ECS::saveSnapshot / ECS::loadSnapshot. Components are stored as raw column
+// blobs in native byte order and struct layout, so a snapshot only loads into builds made by
+// the same compiler for the same platform. Types are matched by name, size and alignment.
+// Every section starts on a SNAPSHOT_ALIGNMENT boundary:
+//
+//   SnapshotHeader
+//   per type: SnapshotType, name
+//   uint32_t generations[slotCount], uint32_t freeList[freeCount]
+//   per archetype: SnapshotArchetype, uint32_t types[typeCount], uint32_t entities[rowCount],
+//                  then rowCount values of every type in order
+//   per sparse set: SnapshotSparseSet, uint32_t entities[count], then count values unless the
+//                   type is a tag
+//
+// Type references are indices into the snapshot's own type table.
+
+inline constexpr uint32_t SNAPSHOT_MAGIC = 0x53534345;// "ECSS"
+inline constexpr uint32_t SNAPSHOT_VERSION = 1;
+inline constexpr size_t SNAPSHOT_ALIGNMENT = 16;
+
+struct SnapshotHeader
+{
+    uint32_t m_magic;
+    uint32_t m_version;
+    uint32_t m_typeCount;
+    uint32_t m_archetypeCount;
+    uint32_t m_sparseSetCount;
+    uint32_t m_slotCount;
+    uint32_t m_freeCount;
+    uint32_t m_reserved;
+};
+
+struct SnapshotType
+{
+    uint32_t m_size;
+    uint32_t m_alignment;
+    uint32_t m_storage;// ComponentStorage
+    uint32_t m_nameLength;
+};
+
+struct SnapshotArchetype
+{
+    uint32_t m_typeCount;
+    uint32_t m_rowCount;
+};
+
+struct SnapshotSparseSet
+{
+    uint32_t m_type;
+    uint32_t m_count;
+};
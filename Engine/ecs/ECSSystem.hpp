@@ -16,21 +16,55 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstdint>
+#include <type_traits>
+#include <typeinfo>
 #include <vector>
 
+#include "ECSCommandBuffer.hpp"
 #include "ECSComponent.hpp"
 #include "ECS.hpp"
+#include "ECSView.hpp"
+#include "../jobs/JobSystem.hpp"
 
 class ECSSystem
 {
   public:
     static constexpr uint8_t OPTIONAL_BIT = 1;
+    static constexpr uint8_t READ_ONLY_BIT = 2;// the system never writes this component, lets the scheduler overlap readers
 
     ECSSystem() = default;
     virtual ~ECSSystem() = default;
 
-    virtual void update(float delta, Entity_t entity) = 0;// how do component access ???
+    // called once per run before any update()/updateChunk(), good place to sample input
+    virtual void beginUpdate([[maybe_unused]] float delta) {}
+
+    // checked right after beginUpdate, returning false skips this run so nothing gets written
+    // or marked changed
+    [[nodiscard]] virtual bool needsUpdate() const { return true; }
+
+    // per entity work, systems overriding updateChunk never get it called
+    virtual void update(float delta, Entity_t entity) = 0;
+
+    // one call per matching chunk, the default forwards every row to update().
+    // systems requiring sparse set types skip this and get update() for every matching entity.
+    virtual void updateChunk(float delta, const Archetype& archetype, const ArchetypeChunk& chunk)
+    {
+        const uint32_t* entities = archetype.entities(chunk);
+
+        for (uint32_t i = 0; i < chunk.m_count; i++) {
+            update(delta, m_parentECS->handle(entities[i]));
+        }
+    }
+
+    // shows up in stats, the compiler's type name unless overridden
+    [[nodiscard]] virtual const char* name() const { return typeid(*this).name(); }
+
+    // wall time from beginUpdate to the last chunk, including time spent waiting on workers
+    [[nodiscard]] inline double lastRunMilliseconds() const { return std::chrono::duration<double, std::milli>(m_lastRunTime).count(); }
+    [[nodiscard]] inline double averageRunMilliseconds() const { return m_runCount == 0 ? 0.0 : std::chrono::duration<double, std::milli>(m_totalRunTime).count() / static_cast<double>(m_runCount); }
+    [[nodiscard]] constexpr uint64_t runCount() const { return m_runCount; }
 
     [[nodiscard]] constexpr const std::vector<uint32_t>& types() const
     {
@@ -53,9 +87,28 @@ class ECSSystem
         return false;
     }
 
-    constexpr void setECS(ECS* parent) { m_parentECS = parent; }
+    // systems touching window/input state have to stay on the thread that owns the window
+    [[nodiscard]] constexpr bool mainThreadOnly() const { return m_mainThreadOnly; }
+
+    // update() may run concurrently for different entities, big systems get split into chunk ranges
+    [[nodiscard]] constexpr bool parallelRows() const { return m_parallelRows; }
+
+    constexpr void setJobSystem(JobSystem* jobs) { m_jobs = jobs; }
+
+    // one buffer per job system thread, indexed by JobSystem::threadIndex()
+    constexpr void setCommandBuffers(ECSCommandBuffer* commandBuffers) { m_commandBuffers = commandBuffers; }
+
+    constexpr void setECS(ECS* parent)
+    {
+        if (m_parentECS != parent) {
+            m_query = nullptr;
+        }
+
+        m_parentECS = parent;
+    }
 
   protected:
+    // get<const C> for read only access, anything else marks the component changed
     template<typename Component>
     [[nodiscard]] Component* get(Entity_t entity) const
     {
@@ -63,18 +116,84 @@ class ECSSystem
             return nullptr;
         }
 
-        return m_parentECS->get<Component>(entity);
+        return m_parentECS->get<Component>(entity, m_runTick);
     }
 
+    // whether Component was written in the chunk since the previous run of this system,
+    // always true on the first run
+    template<typename Component>
+    [[nodiscard]] bool changed(const Archetype& archetype, const ArchetypeChunk& chunk) const
+    {
+        static_assert(Component::STORAGE == ComponentStorage::ARCHETYPE, "change tracking only covers archetype stored components");
+
+        int32_t column = archetype.columnIndex(Component::ID);
+        return column >= 0 && Archetype::changedSince(archetype.version(chunk, static_cast<size_t>(column)), m_lastRunTick);
+    }
+
+    // the world this system runs in and its query, valid from the first update on
+    [[nodiscard]] constexpr ECS& scene() const { return *m_parentECS; }
+    [[nodiscard]] constexpr const ECSQuery& query() const { return *m_query; }
+
+    // tick writes of the current run get marked with
+    [[nodiscard]] constexpr uint32_t runTick() const { return m_runTick; }
+
     void addComponentType(uint32_t componentID, uint8_t flags = 0)
     {
         m_componentTypes.push_back(componentID);
         m_componentFlags.push_back(flags);
     }
 
+    // declares every component of a view, const ones read only
+    template<typename... Components>
+    void addComponentTypes()
+    {
+        (addComponentType(std::remove_const_t<Components>::ID, std::is_const_v<Components> ? READ_ONLY_BIT : 0), ...);
+    }
+
+    // typed access to the chunks handed to updateChunk, should match the declared types
+    template<typename... Components>
+    [[nodiscard]] ECSView<Components...> view() const
+    {
+        return ECSView<Components...>(*m_parentECS, m_runTick);
+    }
+
+    // the job system of the scheduler running this system, nullptr when updated through ECS::updateSystems
+    [[nodiscard]] constexpr JobSystem* jobs() const { return m_jobs; }
+
+    // structural changes have to go through here while iterating, they're applied once
+    // every system of the current update finished
+    [[nodiscard]] inline ECSCommandBuffer& commands() const
+    {
+        if (m_commandBuffers != nullptr && m_jobs != nullptr) {
+            return m_commandBuffers[m_jobs->threadIndex()];
+        }
+
+        return m_parentECS->deferred();
+    }
+
+    constexpr void requireMainThread() { m_mainThreadOnly = true; }
+    constexpr void allowParallelRows() { m_parallelRows = true; }
+
   private:
     std::vector<uint32_t> m_componentTypes;
     std::vector<uint8_t> m_componentFlags;
 
+    bool m_mainThreadOnly = false;
+    bool m_parallelRows = false;
+
     ECS* m_parentECS = nullptr;
+    JobSystem* m_jobs = nullptr;
+    ECSCommandBuffer* m_commandBuffers = nullptr;
+    ECSQuery* m_query = nullptr;// resolved by the parent ECS on the first update
+
+    uint32_t m_runTick = 0;
+    uint32_t m_lastRunTick = 0;
+
+    // timing, written by ECS::beginSystemRun/endSystemRun
+    std::chrono::steady_clock::time_point m_runStart;
+    std::chrono::steady_clock::duration m_lastRunTime{ 0 };
+    std::chrono::steady_clock::duration m_totalRunTime{ 0 };
+    uint64_t m_runCount = 0;
+
+    friend class ECS;
 };
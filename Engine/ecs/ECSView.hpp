@@ -0,0 +1,232 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "Archetype.hpp"
+#include "ComponentMask.hpp"
+#include "ECS.hpp"
+#include "ECSComponent.hpp"
+#include "SparseSet.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Typed iteration over every entity with all of Components. Const components are handed
+// out as const references, which is also how systems declare them read only through
+// ECSSystem::addComponentTypes. Columns are resolved once per chunk, the callback gets
+// inlined into the row loop.
+//
+//   scene.view<Transform, const Camera>().each([](Transform& transform, const Camera& camera) { ... });
+//   scene.view<Transform>().each([](Entity_t entity, Transform& transform) { ... });
+template<typename... Components>
+class ECSView
+{
+    static_assert(sizeof...(Components) > 0, "a view needs at least one component type");
+
+    static constexpr bool HAS_SPARSE = ((std::remove_const_t<Components>::STORAGE == ComponentStorage::SPARSE_SET) || ...);
+
+    // what each() keeps per component while walking a chunk
+    template<typename Component>
+    using Column = std::conditional_t<std::remove_const_t<Component>::STORAGE == ComponentStorage::SPARSE_SET, const SparseSet*, Component*>;
+
+  public:
+    // non const components get marked changed with tick
+    ECSView(ECS& ecs, uint32_t tick) : m_ecs(ecs), m_tick(tick) {}
+
+    // every component type of the view, archetype and sparse alike
+    [[nodiscard]] static const ComponentMask& mask()
+    {
+        static const ComponentMask viewMask = [] {
+            ComponentMask types;
+            (types.set(std::remove_const_t<Components>::ID), ...);
+            return types;
+        }();
+
+        return viewMask;
+    }
+
+    // walks the whole world, resolves the query on first use so it has to run on the
+    // thread doing structural changes
+    template<typename Function>
+    void each(Function&& function) const
+    {
+        const ECSQuery& query = *m_ecs.query(mask());
+
+        if constexpr (HAS_SPARSE) {
+            eachSparse(query, function);
+        } else {
+            for (Archetype* archetype : query.m_archetypes) {
+                for (const ArchetypeChunk& chunk : archetype->chunks()) {
+                    each(*archetype, chunk, function);
+                }
+            }
+        }
+    }
+
+    // walks a single chunk of an archetype matching the view's archetype stored types,
+    // safe to call from ECSSystem::updateChunk on any thread
+    template<typename Function>
+    void each(const Archetype& archetype, const ArchetypeChunk& chunk, Function&& function) const
+    {
+        eachRow(archetype, chunk, function, std::index_sequence_for<Components...>{});
+    }
+
+  private:
+    ECS& m_ecs;
+    uint32_t m_tick;
+
+    template<typename Component>
+    inline void markWritten(const Archetype& archetype, const ArchetypeChunk& chunk) const
+    {
+        typedef std::remove_const_t<Component> Type;
+
+        if constexpr (!std::is_const_v<Component> && Type::STORAGE == ComponentStorage::ARCHETYPE) {
+            archetype.markChanged(chunk, static_cast<size_t>(archetype.columnIndex(Type::ID)), m_tick);
+        }
+    }
+
+    template<typename Component>
+    [[nodiscard]] Column<Component> column(const Archetype& archetype, const ArchetypeChunk& chunk) const
+    {
+        typedef std::remove_const_t<Component> Type;
+
+        if constexpr (Type::STORAGE == ComponentStorage::SPARSE_SET) {
+            return m_ecs.sparseSet(Type::ID);
+        } else {
+            size_t index = static_cast<size_t>(archetype.columnIndex(Type::ID));
+            return static_cast<Component*>(static_cast<void*>(archetype.column(chunk, index)));
+        }
+    }
+
+    template<typename Component>
+    [[nodiscard]] static inline Component& fetch(Column<Component> column, uint32_t row, uint32_t entityIndex)
+    {
+        if constexpr (std::remove_const_t<Component>::STORAGE == ComponentStorage::SPARSE_SET) {
+            if constexpr (std::is_empty_v<Component>) {
+                static std::remove_const_t<Component> tag;// tags have no storage, any instance will do
+                return tag;
+            } else {
+                return *static_cast<Component*>(column->get(entityIndex));
+            }
+        } else {
+            return column[row];
+        }
+    }
+
+    template<typename Component>
+    [[nodiscard]] static inline bool contains(Column<Component> column, uint32_t entityIndex)
+    {
+        if constexpr (std::remove_const_t<Component>::STORAGE == ComponentStorage::SPARSE_SET) {
+            return column->contains(entityIndex);
+        } else {
+            return true;
+        }
+    }
+
+    template<typename Function>
+    inline void invoke(Function& function, uint32_t entityIndex, Components&... components) const
+    {
+        if constexpr (std::is_invocable_v<Function&, Entity_t, Components&...>) {
+            function(m_ecs.handle(entityIndex), components...);
+        } else {
+            function(components...);
+        }
+    }
+
+    template<typename Function, size_t... I>
+    void eachRow(const Archetype& archetype, const ArchetypeChunk& chunk, Function& function, std::index_sequence<I...>) const
+    {
+        std::tuple<Column<Components>...> columns{ column<Components>(archetype, chunk)... };
+        const uint32_t* entities = archetype.entities(chunk);
+
+        if constexpr (HAS_SPARSE) {
+            if (((std::get<I>(columns) == nullptr) || ...)) {
+                return;// a required sparse type nobody has yet
+            }
+        }
+
+        (markWritten<Components>(archetype, chunk), ...);
+
+        for (uint32_t row = 0; row < chunk.m_count; row++) {
+            if constexpr (HAS_SPARSE) {
+                if (!(contains<Components>(std::get<I>(columns), entities[row]) && ...)) {
+                    continue;
+                }
+            }
+
+            invoke(function, entities[row], fetch<Components>(std::get<I>(columns), row, entities[row])...);
+        }
+    }
+
+    // driven by the smallest sparse set instead of every matching archetype row
+    template<typename Function>
+    void eachSparse(const ECSQuery& query, Function& function) const
+    {
+        const SparseSet* smallest = nullptr;
+
+        for (uint32_t type : query.m_sparse) {
+            const SparseSet* set = m_ecs.sparseSet(type);
+            if (set == nullptr) {
+                return;
+            }
+
+            if (smallest == nullptr || set->size() < smallest->size()) {
+                smallest = set;
+            }
+        }
+
+        for (uint32_t entityIndex : smallest->entities()) {
+            const EntityDef& def = m_ecs.entity(entityIndex);
+            if (!def.m_archetype->hasAll(query.m_required)) {
+                continue;
+            }
+
+            eachEntity(def, entityIndex, function, std::index_sequence_for<Components...>{});
+        }
+    }
+
+    template<typename Function, size_t... I>
+    void eachEntity(const EntityDef& def, uint32_t entityIndex, Function& function, std::index_sequence<I...>) const
+    {
+        std::tuple<Column<Components>...> columns{ rowComponent<Components>(def, entityIndex)... };
+
+        if (((std::get<I>(columns) == nullptr) || ...)) {
+            return;
+        }
+
+        (markWritten<Components>(*def.m_archetype, def.m_archetype->chunkOf(def.m_row)), ...);
+        invoke(function, entityIndex, fetch<Components>(std::get<I>(columns), 0, entityIndex)...);
+    }
+
+    // archetype columns are offset to the entity's row so fetch() can index them with 0,
+    // sparse sets are returned only if they contain the entity
+    template<typename Component>
+    [[nodiscard]] Column<Component> rowComponent(const EntityDef& def, uint32_t entityIndex) const
+    {
+        typedef std::remove_const_t<Component> Type;
+
+        if constexpr (Type::STORAGE == ComponentStorage::SPARSE_SET) {
+            const SparseSet* set = m_ecs.sparseSet(Type::ID);
+            return set->contains(entityIndex) ? set : nullptr;
+        } else {
+            return static_cast<Component*>(def.m_archetype->component(def.m_row, static_cast<size_t>(def.m_archetype->columnIndex(Type::ID))));
+        }
+    }
+};
@@ -0,0 +1,48 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "EventBus.hpp"
+
+std::atomic<uint32_t> EventBus::eventTypeCount{ 0 };
+
+EventBus::~EventBus()
+{
+    for (auto& stream : m_streams) {
+        delete stream.load(std::memory_order_relaxed);
+    }
+}
+
+void EventBus::swap()
+{
+    for (auto& slot : m_streams) {
+        BaseEventStream* stream = slot.load(std::memory_order_acquire);
+
+        if (stream != nullptr) {
+            stream->swap();
+        }
+    }
+}
+
+uint32_t EventBus::registerEventType()
+{
+    uint32_t id = eventTypeCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (id >= MAX_EVENT_TYPES) {
+        throw std::runtime_error("Too many event types, raise EventBus::MAX_EVENT_TYPES.");
+    }
+
+    return id;
+}
@@ -0,0 +1,286 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+class BaseEventStream
+{
+  public:
+    virtual ~BaseEventStream() = default;
+
+    // sync point, see EventStream::swap
+    virtual void swap() = 0;
+};
+
+// Per frame stream of one event type. Any thread may publish while systems run: publishing
+// reserves a slot in the current block with a single fetch_add, a full block gets replaced
+// by a twice as big one through a CAS. No locks are taken. At the sync point swap() hands
+// everything published so far to the readers, which see it as a few contiguous batches until
+// the next swap. Blocks are sized to the previous frame's volume, so a steady stream ends up in
+// a single batch.
+template<typename Event>
+class EventStream : public BaseEventStream
+{
+  public:
+    static constexpr uint32_t INITIAL_CAPACITY = 64;
+
+    EventStream() : m_head(createBlock(INITIAL_CAPACITY, nullptr)) {}
+
+    virtual ~EventStream() override
+    {
+        destroyChain(m_head.load(std::memory_order_relaxed));
+        destroyChain(m_read);
+        destroyChain(m_spare);
+    }
+
+    EventStream(const EventStream&) = delete;
+    void operator=(const EventStream&) = delete;
+
+    // any thread
+    template<typename... Args>
+    void publish(Args&&... args)
+    {
+        Block* block = m_head.load(std::memory_order_acquire);
+
+        for (;;) {
+            uint32_t index = block->m_reserved.fetch_add(1, std::memory_order_relaxed);
+
+            if (index < block->m_capacity) {
+                new (block->events() + index) Event(std::forward<Args>(args)...);
+                return;
+            }
+
+            Block* grown = createBlock(block->m_capacity * 2, block);
+            if (m_head.compare_exchange_strong(block, grown, std::memory_order_acq_rel)) {
+                block = grown;
+            } else {
+                grown->m_next = nullptr;// someone else grew it, block is the new head now
+                destroyChain(grown);
+            }
+        }
+    }
+
+    // Reads are only valid between sync points, never concurrently with swap().
+    // every event published before the last swap in publish order per block, as contiguous spans
+    template<typename Function>
+    void eachBatch(Function&& function) const
+    {
+        for (Block* block = m_read; block != nullptr; block = block->m_next) {
+            if (block->size() > 0) {
+                function(std::span<const Event>(block->events(), block->size()));
+            }
+        }
+    }
+
+    template<typename Function>
+    void each(Function&& function) const
+    {
+        eachBatch([&function](std::span<const Event> events) {
+            for (const Event& event : events) {
+                function(event);
+            }
+        });
+    }
+
+    [[nodiscard]] inline size_t size() const { return m_readCount; }
+    [[nodiscard]] inline bool empty() const { return m_readCount == 0; }
+
+    // Must not run while anything publishes or reads. Drops the events read this frame,
+    // the ones published since the last swap become readable.
+    virtual void swap() override
+    {
+        clearChain(m_read);
+        recycle(m_read);
+
+        // the head is the newest block, readers get the oldest first
+        Block* oldest = nullptr;
+        m_readCount = 0;
+
+        for (Block* block = m_head.load(std::memory_order_relaxed); block != nullptr;) {
+            Block* next = block->m_next;
+            block->m_next = oldest;
+            oldest = block;
+            m_readCount += block->size();
+            block = next;
+        }
+
+        m_read = oldest;
+
+        uint32_t capacity = INITIAL_CAPACITY;
+        while (capacity < m_readCount) {
+            capacity *= 2;
+        }
+
+        Block* head = m_spare;
+        if (head != nullptr && head->m_capacity >= capacity) {
+            m_spare = nullptr;
+        } else {
+            head = createBlock(capacity, nullptr);
+        }
+
+        head->m_reserved.store(0, std::memory_order_relaxed);
+        m_head.store(head, std::memory_order_release);
+    }
+
+  private:
+    struct Block
+    {
+        static constexpr size_t EVENTS_OFFSET = (sizeof(uint64_t) * 4 + alignof(Event) - 1) / alignof(Event) * alignof(Event);
+
+        std::atomic<uint32_t> m_reserved{ 0 };// may run past the capacity while the block is full
+        uint32_t m_capacity;
+        Block* m_next;// older block
+
+        Block(uint32_t capacity, Block* next) : m_capacity(capacity), m_next(next) {}
+
+        [[nodiscard]] inline Event* events() const
+        {
+            return static_cast<Event*>(static_cast<void*>(static_cast<uint8_t*>(static_cast<void*>(const_cast<Block*>(this))) + EVENTS_OFFSET));
+        }
+
+        [[nodiscard]] inline uint32_t size() const
+        {
+            return std::min(m_reserved.load(std::memory_order_relaxed), m_capacity);
+        }
+    };
+
+    static_assert(sizeof(Block) <= Block::EVENTS_OFFSET);
+
+    static constexpr std::align_val_t BLOCK_ALIGNMENT{ std::max<size_t>(alignof(Block), alignof(Event)) };
+
+    alignas(64) std::atomic<Block*> m_head;// written by publishers, kept away from the reader state
+
+    Block* m_read = nullptr;// oldest first
+    size_t m_readCount = 0;
+    Block* m_spare = nullptr;// the biggest drained block, reused as the next head
+
+    [[nodiscard]] static Block* createBlock(uint32_t capacity, Block* next)
+    {
+        void* memory = ::operator new(Block::EVENTS_OFFSET + capacity * sizeof(Event), BLOCK_ALIGNMENT);
+        return new (memory) Block(capacity, next);
+    }
+
+    static void clearChain(Block* block)
+    {
+        for (; block != nullptr; block = block->m_next) {
+            std::destroy_n(block->events(), block->size());
+            block->m_reserved.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    static void destroyChain(Block* block)
+    {
+        clearChain(block);
+
+        while (block != nullptr) {
+            Block* next = block->m_next;
+            block->~Block();
+            ::operator delete(block, BLOCK_ALIGNMENT);
+            block = next;
+        }
+    }
+
+    // keeps the biggest drained block of the chain around, frees the rest
+    void recycle(Block* chain)
+    {
+        for (Block* block = chain; block != nullptr;) {
+            Block* next = block->m_next;
+            block->m_next = nullptr;
+
+            if (m_spare == nullptr || block->m_capacity > m_spare->m_capacity) {
+                std::swap(block, m_spare);
+            }
+
+            destroyChain(block);
+            block = next;
+        }
+
+        m_read = nullptr;
+    }
+};
+
+// Typed event streams shared by every system of a scene, see ECS::events. Streams are created
+// on first use from any thread without locking. Events published during a frame become readable
+// once swap() ran at the frame's sync point and stay readable until the next one.
+//
+//   struct EntityHit { Entity_t m_entity; float m_damage; };
+//
+//   events().publish<EntityHit>(EntityHit{ target, 10.0f });// any system, any thread
+//   events().stream<EntityHit>().each([](const EntityHit& hit) { ... });// next frame
+class EventBus
+{
+  public:
+    static constexpr uint32_t MAX_EVENT_TYPES = 256;
+
+    EventBus() = default;
+    ~EventBus();
+
+    EventBus(const EventBus&) = delete;
+    void operator=(const EventBus&) = delete;
+
+    template<typename Event>
+    [[nodiscard]] EventStream<Event>& stream()
+    {
+        std::atomic<BaseEventStream*>& slot = m_streams[typeID<Event>()];
+        BaseEventStream* stream = slot.load(std::memory_order_acquire);
+
+        if (stream == nullptr) {
+            BaseEventStream* created = new EventStream<Event>();
+
+            if (slot.compare_exchange_strong(stream, created, std::memory_order_acq_rel)) {
+                stream = created;
+            } else {
+                delete created;
+            }
+        }
+
+        return *static_cast<EventStream<Event>*>(stream);
+    }
+
+    template<typename Event, typename... Args>
+    void publish(Args&&... args)
+    {
+        stream<Event>().publish(std::forward<Args>(args)...);
+    }
+
+    // sync point of every stream, nothing may publish or read while it runs
+    void swap();
+
+  private:
+    std::array<std::atomic<BaseEventStream*>, MAX_EVENT_TYPES> m_streams{};
+
+    static std::atomic<uint32_t> eventTypeCount;
+
+    template<typename Event>
+    [[nodiscard]] static uint32_t typeID()
+    {
+        static const uint32_t id = registerEventType();
+        return id;
+    }
+
+    [[nodiscard]] static uint32_t registerEventType();
+};
@@ -0,0 +1,114 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "SparseSet.hpp"
+
+#include <algorithm>
+
+SparseSet::SparseSet(uint32_t typeID, ComponentPool& pool) : m_pool(pool), m_typeID(typeID)
+{
+    m_elementSize = BaseECSComponent::isTagType(typeID) ? 0 : BaseECSComponent::getTypeSize(typeID);
+    m_pageBytes = std::max(ComponentPool::PAGE_SIZE, m_elementSize);
+    m_elementsPerPage = m_elementSize == 0 ? 0 : static_cast<uint32_t>(m_pageBytes / m_elementSize);
+}
+
+SparseSet::~SparseSet()
+{
+    if (!isTag()) {
+        for (uint32_t i = 0; i < size(); i++) {
+            BaseECSComponent::getTypeFreeFunc(m_typeID)(static_cast<BaseECSComponent*>(element(i)));
+        }
+    }
+
+    while (!m_pages.empty()) {
+        popPage();
+    }
+}
+
+void* SparseSet::emplace(uint32_t entityIndex)
+{
+    if (contains(entityIndex)) {
+        void* memory = get(entityIndex);
+
+        if (memory != nullptr) {
+            BaseECSComponent::getTypeFreeFunc(m_typeID)(static_cast<BaseECSComponent*>(memory));
+        }
+
+        return memory;
+    }
+
+    if (entityIndex >= m_sparse.size()) {
+        m_sparse.resize(entityIndex + 1, INVALID_INDEX);
+    }
+
+    uint32_t packedIndex = size();
+    m_sparse[entityIndex] = packedIndex;
+    m_pool.countAdds(m_typeID, 1);
+    m_packed.push_back(entityIndex);
+
+    if (isTag()) {
+        return nullptr;
+    }
+
+    if (packedIndex == m_pages.size() * m_elementsPerPage) {
+        m_pages.push_back(static_cast<uint8_t*>(m_pool.allocate(m_pageBytes)));
+        m_pool.track(m_typeID, m_elementsPerPage * m_elementSize);
+    }
+
+    return element(packedIndex);
+}
+
+bool SparseSet::remove(uint32_t entityIndex)
+{
+    if (!contains(entityIndex)) {
+        return false;
+    }
+
+    uint32_t packedIndex = m_sparse[entityIndex];
+    uint32_t lastIndex = size() - 1;
+
+    if (!isTag()) {
+        ECSFreeFunc_t freefn = BaseECSComponent::getTypeFreeFunc(m_typeID);
+        freefn(static_cast<BaseECSComponent*>(element(packedIndex)));
+
+        if (packedIndex != lastIndex) {
+            BaseECSComponent::getTypeMoveFunc(m_typeID)(element(packedIndex), static_cast<BaseECSComponent*>(element(lastIndex)));
+            m_pool.countMove(m_typeID, m_elementSize);
+        }
+
+        // keep a single spare page around so toggling around a page boundary doesn't thrash
+        if (m_pages.size() > 1 && lastIndex <= (m_pages.size() - 2) * m_elementsPerPage) {
+            popPage();
+        }
+    }
+
+    m_pool.countRemoves(m_typeID, 1);
+
+    uint32_t movedEntity = m_packed[lastIndex];
+    m_packed[packedIndex] = movedEntity;
+    m_sparse[movedEntity] = packedIndex;
+    m_packed.pop_back();
+    m_sparse[entityIndex] = INVALID_INDEX;
+
+    return true;
+}
+
+void SparseSet::popPage()
+{
+    m_pool.untrack(m_typeID, m_elementsPerPage * m_elementSize);
+    m_pool.free(m_pages.back(), m_pageBytes);
+    m_pages.pop_back();
+}
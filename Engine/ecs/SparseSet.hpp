@@ -0,0 +1,91 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "ComponentPool.hpp"
+#include "ECSComponent.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Storage for a single ComponentStorage::SPARSE_SET component type. The sparse array maps
+// entity indices to a slot in the packed arrays, so add/remove/lookup are O(1) and never
+// touch the entity's archetype. Values live in fixed size pages and don't relocate when the
+// set grows. Tag types only keep the index arrays.
+class SparseSet
+{
+  public:
+    static constexpr uint32_t INVALID_INDEX = static_cast<uint32_t>(-1);
+
+    SparseSet(uint32_t typeID, ComponentPool& pool);
+    ~SparseSet();
+
+    SparseSet(const SparseSet&) = delete;
+    void operator=(const SparseSet&) = delete;
+
+    [[nodiscard]] constexpr uint32_t typeID() const { return m_typeID; }
+    [[nodiscard]] constexpr bool isTag() const { return m_elementSize == 0; }
+
+    // entity indices in packed order
+    [[nodiscard]] constexpr const std::vector<uint32_t>& entities() const { return m_packed; }
+    [[nodiscard]] inline uint32_t size() const { return static_cast<uint32_t>(m_packed.size()); }
+
+    // values in packed order, elementsPerPage() per page, empty for tags
+    [[nodiscard]] constexpr const std::vector<uint8_t*>& pages() const { return m_pages; }
+    [[nodiscard]] constexpr uint32_t elementsPerPage() const { return m_elementsPerPage; }
+
+    [[nodiscard]] inline bool contains(uint32_t entityIndex) const
+    {
+        return entityIndex < m_sparse.size() && m_sparse[entityIndex] != INVALID_INDEX;
+    }
+
+    // the entity's value, nullptr if it has none or the type is a tag
+    [[nodiscard]] inline void* get(uint32_t entityIndex) const
+    {
+        if (isTag() || !contains(entityIndex)) {
+            return nullptr;
+        }
+
+        return element(m_sparse[entityIndex]);
+    }
+
+    // returns uninitialized (or destroyed, if the entity already had one) memory for the value,
+    // nullptr for tags
+    [[nodiscard]] void* emplace(uint32_t entityIndex);
+
+    // destroys the entity's value and fills the hole with the last one
+    bool remove(uint32_t entityIndex);
+
+  private:
+    ComponentPool& m_pool;
+    uint32_t m_typeID;
+    size_t m_elementSize;
+    size_t m_pageBytes;
+    uint32_t m_elementsPerPage;
+
+    std::vector<uint32_t> m_sparse;// entity index -> packed index
+    std::vector<uint32_t> m_packed;// packed index -> entity index
+    std::vector<uint8_t*> m_pages;
+
+    [[nodiscard]] inline void* element(uint32_t packedIndex) const
+    {
+        return m_pages[packedIndex / m_elementsPerPage] + (packedIndex % m_elementsPerPage) * m_elementSize;
+    }
+
+    void popPage();
+};
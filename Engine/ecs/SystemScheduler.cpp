@@ -0,0 +1,193 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "SystemScheduler.hpp"
+#include "../profiling/Profiler.hpp"
+
+#include <algorithm>
+#include <thread>
+
+SystemScheduler::SystemScheduler(ECS& scene, JobSystem& jobs) : m_scene(scene),
+                                                                 m_jobs(jobs),
+                                                                 m_commandBuffers{ std::make_unique<ECSCommandBuffer[]>(jobs.workerCount() + 1) }
+{
+}
+
+void SystemScheduler::addSystem(ECSSystem* system)
+{
+    system->setJobSystem(&m_jobs);
+    system->setCommandBuffers(m_commandBuffers.get());
+    m_systems.push_back(system);
+    m_graphDirty = true;
+}
+
+void SystemScheduler::run(float delta)
+{
+    PROFILE_ZONE("SystemScheduler::run");
+
+    if (m_graphDirty) {
+        buildGraph();
+    }
+
+    if (m_nodes.empty()) {
+        return;
+    }
+
+    m_delta = delta;
+    m_completed.store(0, std::memory_order_relaxed);
+
+    for (size_t i = 0; i < m_nodes.size(); i++) {
+        m_remaining[i].store(m_nodes[i].m_dependencyCount, std::memory_order_relaxed);
+    }
+
+    for (size_t i = 0; i < m_nodes.size(); i++) {
+        if (m_nodes[i].m_dependencyCount == 0) {
+            dispatch(i);
+        }
+    }
+
+    // the calling thread runs main thread only systems and helps out with everything else
+    while (m_completed.load(std::memory_order_acquire) < m_nodes.size()) {
+        bool hasMainThreadWork = false;
+        size_t node = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+            if (!m_mainThreadQueue.empty()) {
+                node = m_mainThreadQueue.back();
+                m_mainThreadQueue.pop_back();
+                hasMainThreadWork = true;
+            }
+        }
+
+        if (hasMainThreadWork) {
+            execute(node);
+        } else if (!m_jobs.tryRunOne()) {
+            std::this_thread::yield();
+        }
+    }
+
+    m_jobs.wait(m_jobCounter);
+
+    // sync point, nothing iterates anymore
+    for (uint32_t i = 0; i <= m_jobs.workerCount(); i++) {
+        m_scene.playback(m_commandBuffers[i]);
+    }
+}
+
+void SystemScheduler::buildGraph()
+{
+    m_nodes.clear();
+    m_nodes.resize(m_systems.size());
+    m_remaining = std::make_unique<std::atomic<uint32_t>[]>(m_systems.size());
+
+    for (size_t i = 0; i < m_systems.size(); i++) {
+        ECSSystem* system = m_systems[i];
+        Node& node = m_nodes[i];
+
+        // queries are resolved here so workers never touch the ECS query cache
+        [[maybe_unused]] ECSQuery* query = m_scene.systemQuery(system);
+
+        for (size_t t = 0; t < system->types().size(); t++) {
+            if (system->flags()[t] & ECSSystem::READ_ONLY_BIT) {
+                node.m_reads.set(system->types()[t]);
+            } else {
+                node.m_writes.set(system->types()[t]);
+            }
+        }
+
+        for (size_t j = 0; j < i; j++) {
+            Node& earlier = m_nodes[j];
+
+            bool conflicts = earlier.m_writes.intersects(node.m_writes)
+                             || earlier.m_writes.intersects(node.m_reads)
+                             || node.m_writes.intersects(earlier.m_reads);
+
+            if (conflicts) {
+                earlier.m_dependents.push_back(i);
+                node.m_dependencyCount++;
+            }
+        }
+    }
+
+    m_graphDirty = false;
+}
+
+void SystemScheduler::dispatch(size_t node)
+{
+    if (m_systems[node]->mainThreadOnly()) {
+        std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+        m_mainThreadQueue.push_back(node);
+        return;
+    }
+
+    m_jobs.run([this, node] { execute(node); }, &m_jobCounter);
+}
+
+void SystemScheduler::execute(size_t node)
+{
+    ECSSystem* system = m_systems[node];
+
+    if (system->parallelRows() && !m_scene.systemQuery(system)->hasSparse()) {
+        updateRows(system);
+    } else {
+        m_scene.updateSystem(system, m_delta);
+    }
+
+    for (size_t dependent : m_nodes[node].m_dependents) {
+        if (m_remaining[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            dispatch(dependent);
+        }
+    }
+
+    m_completed.fetch_add(1, std::memory_order_release);
+}
+
+void SystemScheduler::updateRows(ECSSystem* system)
+{
+    PROFILE_ZONE(system->name());
+
+    ECSQuery* query = m_scene.systemQuery(system);
+    JobCounter rowsCounter;
+
+    m_scene.beginSystemRun(system);
+    system->beginUpdate(m_delta);
+
+    if (!system->needsUpdate()) {
+        m_scene.endSystemRun(system);
+        return;
+    }
+
+    for (Archetype* archetype : query->m_archetypes) {
+        const auto& chunks = archetype->chunks();
+
+        for (size_t first = 0; first < chunks.size(); first += CHUNKS_PER_JOB) {
+            size_t last = std::min(first + CHUNKS_PER_JOB, chunks.size());
+
+            m_jobs.run([this, system, archetype, first, last] {
+                PROFILE_ZONE(system->name());
+
+                for (size_t c = first; c < last; c++) {
+                    m_scene.updateSystemChunk(system, m_delta, *archetype, archetype->chunks()[c]);
+                }
+            },
+                &rowsCounter);
+        }
+    }
+
+    m_jobs.wait(rowsCounter);
+    m_scene.endSystemRun(system);
+}
@@ -0,0 +1,81 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "ComponentMask.hpp"
+#include "ECSCommandBuffer.hpp"
+#include "ECS.hpp"
+#include "ECSSystem.hpp"
+#include "../jobs/JobSystem.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Runs a group of systems on the job system. Systems are ordered by the component
+// access they declare: a system waits on every earlier system it conflicts with
+// (one writes what the other reads or writes), everything else runs concurrently.
+class SystemScheduler
+{
+  public:
+    SystemScheduler(ECS& scene, JobSystem& jobs);
+
+    SystemScheduler(const SystemScheduler&) = delete;
+    void operator=(const SystemScheduler&) = delete;
+
+    void addSystem(ECSSystem* system);
+
+    // runs every system, then applies the structural changes they recorded
+    void run(float delta);
+
+    [[nodiscard]] inline const std::vector<ECSSystem*>& systems() const { return m_systems; }
+
+  private:
+    static constexpr size_t CHUNKS_PER_JOB = 4;
+
+    struct Node
+    {
+        ComponentMask m_reads;
+        ComponentMask m_writes;
+        std::vector<size_t> m_dependents;
+        uint32_t m_dependencyCount = 0;
+    };
+
+    ECS& m_scene;
+    JobSystem& m_jobs;
+
+    std::vector<ECSSystem*> m_systems;
+    std::vector<Node> m_nodes;
+    bool m_graphDirty = false;
+
+    // per run state
+    float m_delta = 0.0f;
+    std::unique_ptr<std::atomic<uint32_t>[]> m_remaining;
+    std::atomic<size_t> m_completed{ 0 };
+    JobCounter m_jobCounter;
+
+    std::unique_ptr<ECSCommandBuffer[]> m_commandBuffers;
+
+    std::mutex m_mainThreadMutex;
+    std::vector<size_t> m_mainThreadQueue;
+
+    void buildGraph();
+    void dispatch(size_t node);
+    void execute(size_t node);
+    void updateRows(ECSSystem* system);
+};
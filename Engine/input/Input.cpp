@@ -0,0 +1,130 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Input.hpp"
+
+#include <iterator>
+#include <spdlog/spdlog.h>
+
+// GLFW codes of Key and MouseButton, in the same order
+static constexpr int KEY_CODES[] = { GLFW_KEY_W, GLFW_KEY_A, GLFW_KEY_S, GLFW_KEY_D };
+static constexpr int BUTTON_CODES[] = { GLFW_MOUSE_BUTTON_LEFT, GLFW_MOUSE_BUTTON_RIGHT };
+
+static_assert(std::size(KEY_CODES) == static_cast<size_t>(Key::COUNT) && std::size(BUTTON_CODES) == static_cast<size_t>(MouseButton::COUNT));
+
+Input::Input(Window& window) : m_window{ window }
+{
+}
+
+bool Input::record(const std::string& path)
+{
+    m_recorder = std::make_unique<InputRecorder>(path, width(), height());
+
+    if (!m_recorder->isOpen()) {
+        spdlog::error("Failed to open {} for recording input.", path);
+        m_recorder.reset();
+        return false;
+    }
+
+    return true;
+}
+
+bool Input::play(const std::string& path)
+{
+    m_player = std::make_unique<InputPlayer>(path);
+    m_playbackFinished = false;
+    m_tickLengthWarned = false;
+
+    if (!m_player->isLoaded()) {
+        spdlog::error("Failed to load the input recording {}", path);
+        m_player.reset();
+        return false;
+    }
+
+    return true;
+}
+
+void Input::stop()
+{
+    if (m_recorder && !m_recorder->finish()) {
+        spdlog::error("Failed to write the input recording.");
+    }
+
+    m_recorder.reset();
+    m_player.reset();
+}
+
+void Input::beginTick(float delta)
+{
+    if (m_player) {
+        if (!m_playbackFinished && !m_player->next(m_state)) {
+            spdlog::info("Input playback finished after {} ticks.", m_player->header().m_ticks);
+
+            // let go of everything, the cursor stays where the last tick left it
+            m_state.m_keys = 0;
+            m_state.m_buttons = 0;
+            m_playbackFinished = true;
+        }
+
+        if (m_player->header().m_tickSeconds != delta && !m_tickLengthWarned) {
+            spdlog::warn("Input was recorded at {} s per tick, playing it back at {} s won't reproduce the run.", m_player->header().m_tickSeconds, delta);
+            m_tickLengthWarned = true;
+        }
+    } else if (!m_window.headless()) {
+        sample();
+    }
+
+    if (m_recorder) {
+        m_recorder->record(m_state, delta);
+    }
+}
+
+void Input::sample()
+{
+    GLFWwindow* window = m_window.glfwWindowPtr();
+
+    m_state.m_keys = 0;
+    for (size_t i = 0; i < std::size(KEY_CODES); i++) {
+        if (glfwGetKey(window, KEY_CODES[i]) == GLFW_PRESS) {
+            m_state.m_keys = static_cast<uint8_t>(m_state.m_keys | (1u << i));
+        }
+    }
+
+    m_state.m_buttons = 0;
+    for (size_t i = 0; i < std::size(BUTTON_CODES); i++) {
+        if (glfwGetMouseButton(window, BUTTON_CODES[i]) == GLFW_PRESS) {
+            m_state.m_buttons = static_cast<uint8_t>(m_state.m_buttons | (1u << i));
+        }
+    }
+
+    glfwGetCursorPos(window, &m_state.m_cursor.x, &m_state.m_cursor.y);
+}
+
+void Input::setCursor(const glm::dvec2& cursor)
+{
+    m_state.m_cursor = cursor;
+
+    if (!m_player && !m_window.headless()) {
+        glfwSetCursorPos(m_window.glfwWindowPtr(), cursor.x, cursor.y);
+    }
+}
+
+void Input::setCursorHidden(bool hidden)
+{
+    if (!m_player && !m_window.headless()) {
+        glfwSetInputMode(m_window.glfwWindowPtr(), GLFW_CURSOR, hidden ? GLFW_CURSOR_HIDDEN : GLFW_CURSOR_NORMAL);
+    }
+}
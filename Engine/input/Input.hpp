@@ -0,0 +1,77 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "InputRecording.hpp"
+#include "InputState.hpp"
+#include "../window.hpp"
+
+// Input as seen by the update systems. It's sampled once per tick from the window, or taken from
+// a recording being played back, so a replayed run goes through exactly the same ticks as the
+// recorded one. Headless windows have no input besides recordings.
+class Input
+{
+  public:
+    explicit Input(Window& window);
+
+    Input(const Input&) = delete;
+    void operator=(const Input&) = delete;
+
+    // writes the input of every tick from now on to path, false if it can't be opened
+    bool record(const std::string& path);
+
+    // replaces the window's input with the recording's from the next tick on, false if it
+    // can't be loaded
+    bool play(const std::string& path);
+
+    // finishes the recording and stops playing back
+    void stop();
+
+    // called by the engine before every update tick
+    void beginTick(float delta);
+
+    [[nodiscard]] inline bool keyDown(Key key) const { return m_state.keyDown(key); }
+    [[nodiscard]] inline bool buttonDown(MouseButton button) const { return m_state.buttonDown(button); }
+    [[nodiscard]] constexpr const glm::dvec2& cursor() const { return m_state.m_cursor; }
+
+    // the size cursor positions are relative to, the recording's while playing one back
+    [[nodiscard]] inline uint32_t width() const { return m_player ? m_player->header().m_width : m_window.width(); }
+    [[nodiscard]] inline uint32_t height() const { return m_player ? m_player->header().m_height : m_window.height(); }
+
+    [[nodiscard]] inline bool playing() const { return m_player != nullptr && !m_playbackFinished; }
+
+    // ticks of the recording being played back, 0 without one
+    [[nodiscard]] inline uint32_t playbackTicks() const { return m_player ? m_player->header().m_ticks : 0; }
+
+    // moves the cursor, while playing back only the state of the current tick is changed
+    void setCursor(const glm::dvec2& cursor);
+    void setCursorHidden(bool hidden);
+
+  private:
+    Window& m_window;
+    InputState m_state;
+
+    std::unique_ptr<InputRecorder> m_recorder;
+    std::unique_ptr<InputPlayer> m_player;
+    bool m_playbackFinished = false;
+    bool m_tickLengthWarned = false;
+
+    void sample();
+};
@@ -0,0 +1,103 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "InputRecording.hpp"
+
+InputRecorder::InputRecorder(const std::string& path, uint32_t width, uint32_t height) : m_file(std::fopen(path.c_str(), "wb")),
+                                                                                          m_header{ INPUT_RECORDING_MAGIC, INPUT_RECORDING_VERSION, width, height, 0.0f, 0 }
+{
+    if (m_file != nullptr) {// rewritten by finish() once the tick count is known
+        m_good = std::fwrite(&m_header, sizeof(m_header), 1, m_file) == 1;
+    }
+}
+
+InputRecorder::~InputRecorder()
+{
+    if (m_file != nullptr) {
+        finish();
+    }
+}
+
+void InputRecorder::record(const InputState& state, float delta)
+{
+    if (m_file == nullptr) {
+        return;
+    }
+
+    if (m_header.m_ticks == 0) {
+        m_header.m_tickSeconds = delta;
+    }
+
+    if (m_header.m_ticks == 0 || !state.sameAs(m_last)) {
+        InputRecord record{ m_header.m_ticks, state.m_keys, state.m_buttons, 0, state.m_cursor.x, state.m_cursor.y };
+        m_good = m_good && std::fwrite(&record, sizeof(record), 1, m_file) == 1;
+        m_last = state;
+    }
+
+    m_header.m_ticks++;
+}
+
+bool InputRecorder::finish()
+{
+    if (m_file == nullptr) {
+        return false;
+    }
+
+    bool good = m_good && std::fseek(m_file, 0, SEEK_SET) == 0 && std::fwrite(&m_header, sizeof(m_header), 1, m_file) == 1;
+    good = std::fclose(m_file) == 0 && good;
+    m_file = nullptr;
+
+    return good;
+}
+
+InputPlayer::InputPlayer(const std::string& path)
+{
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return;
+    }
+
+    bool valid = std::fread(&m_header, sizeof(m_header), 1, file) == 1 && m_header.m_magic == INPUT_RECORDING_MAGIC && m_header.m_version == INPUT_RECORDING_VERSION;
+
+    InputRecord record;
+    while (valid && std::fread(&record, sizeof(record), 1, file) == 1) {
+        // ticks only go up and stay inside the recording
+        valid = record.m_tick < m_header.m_ticks && (m_records.empty() || record.m_tick > m_records.back().m_tick);
+        m_records.push_back(record);
+    }
+
+    m_loaded = valid && std::feof(file) != 0;
+    std::fclose(file);
+}
+
+bool InputPlayer::next(InputState& state)
+{
+    if (!m_loaded || m_tick >= m_header.m_ticks) {
+        return false;
+    }
+
+    if (m_nextRecord < m_records.size() && m_records[m_nextRecord].m_tick == m_tick) {
+        const InputRecord& record = m_records[m_nextRecord++];
+        m_state.m_keys = record.m_keys;
+        m_state.m_buttons = record.m_buttons;
+        m_state.m_cursor = glm::dvec2{ record.m_cursorX, record.m_cursorY };
+    }
+
+    m_tick++;
+    state = m_state;
+
+    return true;
+}
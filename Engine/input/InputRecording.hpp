@@ -0,0 +1,106 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "InputState.hpp"
+
+// File layout of InputRecorder / InputPlayer, native byte order:
+//
+//   InputRecordingHeader
+//   InputRecord records[]
+//
+// A record is only written for ticks whose input differs from the tick before, so holding a key
+// or leaving the mouse alone costs nothing. Ticks are counted from the start of the recording,
+// the header's tick length tells how long one was.
+
+inline constexpr uint32_t INPUT_RECORDING_MAGIC = 0x4E494B56;// "VKIN"
+inline constexpr uint32_t INPUT_RECORDING_VERSION = 1;
+
+struct InputRecordingHeader
+{
+    uint32_t m_magic;
+    uint32_t m_version;
+    uint32_t m_width;// the cursor positions are relative to a window of this size
+    uint32_t m_height;
+    float m_tickSeconds;
+    uint32_t m_ticks;
+};
+
+struct InputRecord
+{
+    uint32_t m_tick;
+    uint8_t m_keys;
+    uint8_t m_buttons;
+    uint16_t m_reserved;
+    double m_cursorX;
+    double m_cursorY;
+};
+
+static_assert(sizeof(InputRecordingHeader) == 24 && sizeof(InputRecord) == 24, "records are written as they are laid out");
+
+// writes one InputState per tick
+class InputRecorder
+{
+  public:
+    InputRecorder(const std::string& path, uint32_t width, uint32_t height);
+    ~InputRecorder();
+
+    InputRecorder(const InputRecorder&) = delete;
+    void operator=(const InputRecorder&) = delete;
+
+    [[nodiscard]] constexpr bool isOpen() const { return m_file != nullptr; }
+    [[nodiscard]] constexpr uint32_t ticks() const { return m_header.m_ticks; }
+
+    void record(const InputState& state, float delta);
+
+    // fills in the header and closes the file, false if any write failed
+    bool finish();
+
+  private:
+    std::FILE* m_file;
+    InputRecordingHeader m_header;
+    InputState m_last;
+    bool m_good = true;
+};
+
+// hands out a recording's InputStates one tick at a time
+class InputPlayer
+{
+  public:
+    // isLoaded() is false if the file is missing or isn't a valid recording
+    explicit InputPlayer(const std::string& path);
+
+    [[nodiscard]] constexpr bool isLoaded() const { return m_loaded; }
+    [[nodiscard]] constexpr const InputRecordingHeader& header() const { return m_header; }
+
+    // the input of the next tick, false once every recorded tick was played
+    bool next(InputState& state);
+
+  private:
+    InputRecordingHeader m_header{};
+    std::vector<InputRecord> m_records;
+    bool m_loaded = false;
+
+    size_t m_nextRecord = 0;
+    uint32_t m_tick = 0;
+    InputState m_state;
+};
@@ -0,0 +1,54 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include <glmNoIW.h>
+
+// the keys and buttons the engine tracks, values are bit indices into InputState
+enum class Key : uint8_t
+{
+    W,
+    A,
+    S,
+    D,
+    COUNT
+};
+
+enum class MouseButton : uint8_t
+{
+    LEFT,
+    RIGHT,
+    COUNT
+};
+
+// everything input driven systems get to read during a tick
+struct InputState
+{
+    uint8_t m_keys = 0;// bit per Key
+    uint8_t m_buttons = 0;// bit per MouseButton
+    glm::dvec2 m_cursor{ 0 };// in pixels from the top left corner
+
+    [[nodiscard]] constexpr bool keyDown(Key key) const { return (m_keys & (1u << static_cast<uint32_t>(key))) != 0; }
+    [[nodiscard]] constexpr bool buttonDown(MouseButton button) const { return (m_buttons & (1u << static_cast<uint32_t>(button))) != 0; }
+
+    [[nodiscard]] inline bool sameAs(const InputState& other) const
+    {
+        return m_keys == other.m_keys && m_buttons == other.m_buttons && m_cursor.x == other.m_cursor.x && m_cursor.y == other.m_cursor.y;
+    }
+};
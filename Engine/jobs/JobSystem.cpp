@@ -0,0 +1,200 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "JobSystem.hpp"
+#include "../profiling/Profiler.hpp"
+
+#include <string>
+
+static thread_local const JobSystem* s_threadOwner = nullptr;
+static thread_local uint32_t s_threadIndex = 0;
+
+JobSystem::JobSystem(uint32_t workerCount)
+{
+    if (workerCount == 0) {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    m_queues = std::make_unique<WorkQueue[]>(workerCount + 1);
+
+    m_workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++) {
+        m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping.store(true);
+    }
+
+    m_sleepCondition.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+uint32_t JobSystem::threadIndex() const
+{
+    return s_threadOwner == this ? s_threadIndex : workerCount();
+}
+
+void JobSystem::run(Job_t job, JobCounter* counter)
+{
+    if (counter != nullptr) {
+        counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    push(Job{ std::move(job), counter });
+}
+
+void JobSystem::runAfter(JobCounter& dependency, Job_t job, JobCounter* counter)
+{
+    if (counter != nullptr) {
+        counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(dependency.m_mutex);
+        if (!dependency.done()) {
+            dependency.m_continuations.push_back(Job{ std::move(job), counter });
+            return;
+        }
+    }
+
+    push(Job{ std::move(job), counter });
+}
+
+void JobSystem::wait(const JobCounter& counter)
+{
+    while (!counter.done()) {
+        if (!tryRunOne()) {
+            std::this_thread::yield();
+        }
+    }
+
+    // the last finisher may still hold the lock, don't let the caller destroy the counter under it
+    std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+bool JobSystem::tryRunOne()
+{
+    Job job;
+    if (!popOrSteal(threadIndex(), job)) {
+        return false;
+    }
+
+    execute(job);
+    return true;
+}
+
+void JobSystem::workerLoop(uint32_t index)
+{
+    s_threadOwner = this;
+    s_threadIndex = index;
+    PROFILE_THREAD("Worker " + std::to_string(index));
+
+    while (!m_stopping.load(std::memory_order_relaxed)) {
+        if (tryRunOne()) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepingWorkers.fetch_add(1);
+        m_sleepCondition.wait(lock, [this] { return m_stopping.load() || m_queuedJobs.load() > 0; });
+        m_sleepingWorkers.fetch_sub(1);
+    }
+}
+
+void JobSystem::push(Job job)
+{
+    WorkQueue& queue = m_queues[threadIndex()];
+
+    {
+        std::lock_guard<std::mutex> lock(queue.m_mutex);
+        queue.m_jobs.push_back(std::move(job));
+    }
+
+    m_queuedJobs.fetch_add(1);
+
+    if (m_sleepingWorkers.load() > 0) {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_sleepCondition.notify_one();
+    }
+}
+
+bool JobSystem::popOrSteal(uint32_t queueIndex, Job& job)
+{
+    if (m_queuedJobs.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+
+    {
+        WorkQueue& own = m_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(own.m_mutex);
+
+        if (!own.m_jobs.empty()) {// newest first, it's the most likely to still be in cache
+            job = std::move(own.m_jobs.back());
+            own.m_jobs.pop_back();
+            m_queuedJobs.fetch_sub(1);
+            return true;
+        }
+    }
+
+    uint32_t queueCount = workerCount() + 1;
+    for (uint32_t i = 1; i < queueCount; i++) {
+        WorkQueue& victim = m_queues[(queueIndex + i) % queueCount];
+        std::unique_lock<std::mutex> lock(victim.m_mutex, std::try_to_lock);
+
+        if (lock.owns_lock() && !victim.m_jobs.empty()) {// oldest first, usually the biggest piece of work
+            job = std::move(victim.m_jobs.front());
+            victim.m_jobs.pop_front();
+            m_queuedJobs.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void JobSystem::execute(Job& job)
+{
+    job.m_function();
+
+    if (job.m_counter != nullptr) {
+        finish(*job.m_counter);
+    }
+}
+
+void JobSystem::finish(JobCounter& counter)
+{
+    std::vector<Job> continuations;
+
+    {
+        std::lock_guard<std::mutex> lock(counter.m_mutex);
+        if (counter.m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            continuations.swap(counter.m_continuations);
+        }
+    }
+
+    for (auto& continuation : continuations) {
+        push(std::move(continuation));
+    }
+}
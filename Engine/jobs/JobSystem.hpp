@@ -0,0 +1,124 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobCounter;
+
+struct Job
+{
+    std::function<void()> m_function;
+    JobCounter* m_counter = nullptr;
+};
+
+// Counts outstanding jobs, jobs can also be chained to run once a counter drains.
+class JobCounter
+{
+  public:
+    JobCounter() = default;
+
+    JobCounter(const JobCounter&) = delete;
+    void operator=(const JobCounter&) = delete;
+
+    [[nodiscard]] inline bool done() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+  private:
+    std::atomic<uint32_t> m_pending{ 0 };
+
+    mutable std::mutex m_mutex;
+    std::vector<Job> m_continuations;
+
+    friend class JobSystem;
+};
+
+// Work stealing job system. Every worker owns a deque, it pushes and pops at the back
+// while idle workers steal from the front of the others. Threads outside the pool
+// share one extra deque.
+class JobSystem
+{
+  public:
+    typedef std::function<void()> Job_t;
+
+    // 0 workers picks one less than the hardware concurrency, the calling thread makes up the difference
+    explicit JobSystem(uint32_t workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    void operator=(const JobSystem&) = delete;
+
+    void run(Job_t job, JobCounter* counter = nullptr);
+
+    // queues the job once every job tracked by dependency has finished
+    void runAfter(JobCounter& dependency, Job_t job, JobCounter* counter = nullptr);
+
+    // runs queued jobs on the calling thread until the counter drains
+    void wait(const JobCounter& counter);
+    bool tryRunOne();
+
+    // splits [begin, end) into grainSize ranges, calls function(first, last) on each and waits
+    template<typename Function>
+    void parallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, Function&& function)
+    {
+        JobCounter counter;
+        grainSize = std::max(grainSize, 1u);
+
+        for (uint32_t first = begin; first < end; first += grainSize) {
+            uint32_t last = std::min(end, first + std::min(grainSize, end - first));
+            run([&function, first, last] { function(first, last); }, &counter);
+        }
+
+        wait(counter);
+    }
+
+    [[nodiscard]] inline uint32_t workerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+    // [0, workerCount()) on the pool's workers, workerCount() on every other thread
+    [[nodiscard]] uint32_t threadIndex() const;
+
+  private:
+    struct alignas(64) WorkQueue
+    {
+        std::mutex m_mutex;
+        std::deque<Job> m_jobs;
+    };
+
+    std::vector<std::thread> m_workers;
+    std::unique_ptr<WorkQueue[]> m_queues;
+
+    std::atomic<uint32_t> m_queuedJobs{ 0 };
+    std::atomic<uint32_t> m_sleepingWorkers{ 0 };
+    std::atomic<bool> m_stopping{ false };
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCondition;
+
+    void workerLoop(uint32_t index);
+
+    void push(Job job);
+    [[nodiscard]] bool popOrSteal(uint32_t queueIndex, Job& job);
+    void execute(Job& job);
+    void finish(JobCounter& counter);
+};
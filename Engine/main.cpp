@@ -18,33 +18,111 @@
 
 #include "components/Camera.hpp"
 #include "components/Transform.hpp"
+#include "components/WorldTransform.hpp"
 #include "ecs/ECSComponent.hpp"
 #include "systems/FreeLook.hpp"
 #include "systems/FreeMove.hpp"
 #include "window.hpp"
 #include "CoreEngine.hpp"
 
-int main()
+#include <cstring>
+#include <memory>
+#include <string>
+
+struct Options
+{
+    bool m_headless = false;
+    uint32_t m_frames = 0;// 0 plays the whole input recording
+    std::string m_dumpPath;
+    std::string m_timingsPath;
+    std::string m_recordPath;
+    std::string m_replayPath;
+};
+
+// VkApp [--headless <frames> [--dump <frame.png>] [--timings <timings.json>]]
+//       [--record <input.bin>] [--replay <input.bin>]
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 == argc) {
+            spdlog::critical("{} is missing its value", argv[i]);
+            return false;
+        } else if (std::strcmp(argv[i], "--headless") == 0) {
+            options.m_headless = true;
+            options.m_frames = static_cast<uint32_t>(std::stoul(argv[i + 1]));
+        } else if (std::strcmp(argv[i], "--dump") == 0) {
+            options.m_dumpPath = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--timings") == 0) {
+            options.m_timingsPath = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--record") == 0) {
+            options.m_recordPath = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--replay") == 0) {
+            options.m_replayPath = argv[i + 1];
+        } else {
+            spdlog::critical("Unknown argument {}", argv[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv)
 {
 #ifndef NDEBUG
     spdlog::set_level(spdlog::level::debug);
 #endif
 
-    Window window(1920, 1080, "Vk App");
-    CoreEngine engine(window, 144.0f);
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return EXIT_FAILURE;
+    }
+
+    std::unique_ptr<Window> window = options.m_headless ? std::make_unique<Window>(1920, 1080) : std::make_unique<Window>(1920, 1080, "Vk App");
+    CoreEngine engine(*window, 144.0f);
 
     Entity_t player = engine.scene().createEntity();
 
     engine.scene().addComponent(player, Transform{});
+    engine.scene().addComponent(player, WorldTransform{});
     engine.scene().addComponent(player, Camera{});
 
-    FreeLook lookSystem{ window, 5000.0f, true };
-    FreeMove moveSystem{ window };
+    Input input{ *window };
+    if (!options.m_replayPath.empty() && !input.play(options.m_replayPath)) {
+        return EXIT_FAILURE;
+    }
+
+    if (!options.m_recordPath.empty() && !input.record(options.m_recordPath)) {
+        return EXIT_FAILURE;
+    }
+
+    engine.setInput(&input);
+
+    FreeLook lookSystem{ input, 5000.0f, true };
+    FreeMove moveSystem{ input };
 
     engine.addUpdateSystem(&lookSystem);
     engine.addUpdateSystem(&moveSystem);
 
-    engine.run();
+    if (!options.m_headless) {
+        engine.setPipelined(true);
+        engine.run();
+
+        return EXIT_SUCCESS;
+    }
+
+    uint32_t frames = options.m_frames == 0 ? input.playbackTicks() : options.m_frames;
+    if (frames == 0) {
+        spdlog::critical("Headless runs need a frame count or an input recording to replay.");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<FrameTiming> timings = engine.runFrames(frames);
+
+    bool written = CoreEngine::reportFrameTimings(timings, options.m_timingsPath);
+    if (!options.m_dumpPath.empty()) {
+        written = engine.saveFrame(options.m_dumpPath) && written;
+    }
 
-    return EXIT_SUCCESS;
+    return written ? EXIT_SUCCESS : EXIT_FAILURE;
 }
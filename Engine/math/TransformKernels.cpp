@@ -0,0 +1,246 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "TransformKernels.hpp"
+
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TRANSFORM_KERNELS_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORM_KERNELS_SSE2
+#endif
+
+// The kernels are written once against these lane types, each one wraps a register of
+// WIDTH floats. Stream pointers are cache line aligned, so loads and stores are aligned.
+
+struct ScalarLanes
+{
+    static constexpr size_t WIDTH = 1;
+    float m_value;
+
+    [[nodiscard]] static inline ScalarLanes load(const float* source) { return { *source }; }
+    [[nodiscard]] static inline ScalarLanes broadcast(float value) { return { value }; }
+    inline void store(float* destination) const { *destination = m_value; }
+
+    [[nodiscard]] friend inline ScalarLanes operator+(ScalarLanes a, ScalarLanes b) { return { a.m_value + b.m_value }; }
+    [[nodiscard]] friend inline ScalarLanes operator-(ScalarLanes a, ScalarLanes b) { return { a.m_value - b.m_value }; }
+    [[nodiscard]] friend inline ScalarLanes operator*(ScalarLanes a, ScalarLanes b) { return { a.m_value * b.m_value }; }
+    [[nodiscard]] friend inline ScalarLanes inverseSqrt(ScalarLanes a) { return { 1.0f / std::sqrt(a.m_value) }; }
+};
+
+static inline void storeMatrices(const ScalarLanes (&m)[16], glm::mat4* worlds)
+{
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            worlds[0][c][r] = m[c * 4 + r].m_value;
+        }
+    }
+}
+
+#if defined(TRANSFORM_KERNELS_SSE2) || defined(TRANSFORM_KERNELS_AVX2)
+struct SSELanes
+{
+    static constexpr size_t WIDTH = 4;
+    __m128 m_value;
+
+    [[nodiscard]] static inline SSELanes load(const float* source) { return { _mm_load_ps(source) }; }
+    [[nodiscard]] static inline SSELanes broadcast(float value) { return { _mm_set1_ps(value) }; }
+    inline void store(float* destination) const { _mm_store_ps(destination, m_value); }
+
+    [[nodiscard]] friend inline SSELanes operator+(SSELanes a, SSELanes b) { return { _mm_add_ps(a.m_value, b.m_value) }; }
+    [[nodiscard]] friend inline SSELanes operator-(SSELanes a, SSELanes b) { return { _mm_sub_ps(a.m_value, b.m_value) }; }
+    [[nodiscard]] friend inline SSELanes operator*(SSELanes a, SSELanes b) { return { _mm_mul_ps(a.m_value, b.m_value) }; }
+    [[nodiscard]] friend inline SSELanes inverseSqrt(SSELanes a) { return { _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(a.m_value)) }; }
+};
+
+// rows holds element r of matrix column c for 4 entries, a transpose turns that into
+// column c of each entry
+static inline void storeColumns(__m128 row0, __m128 row1, __m128 row2, __m128 row3, glm::mat4* worlds, int c)
+{
+    _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+    _mm_storeu_ps(&worlds[0][c][0], row0);
+    _mm_storeu_ps(&worlds[1][c][0], row1);
+    _mm_storeu_ps(&worlds[2][c][0], row2);
+    _mm_storeu_ps(&worlds[3][c][0], row3);
+}
+
+static inline void storeMatrices(const SSELanes (&m)[16], glm::mat4* worlds)
+{
+    for (int c = 0; c < 4; c++) {
+        storeColumns(m[c * 4].m_value, m[c * 4 + 1].m_value, m[c * 4 + 2].m_value, m[c * 4 + 3].m_value, worlds, c);
+    }
+}
+#endif
+
+#if defined(TRANSFORM_KERNELS_AVX2)
+struct AVXLanes
+{
+    static constexpr size_t WIDTH = 8;
+    __m256 m_value;
+
+    [[nodiscard]] static inline AVXLanes load(const float* source) { return { _mm256_load_ps(source) }; }
+    [[nodiscard]] static inline AVXLanes broadcast(float value) { return { _mm256_set1_ps(value) }; }
+    inline void store(float* destination) const { _mm256_store_ps(destination, m_value); }
+
+    [[nodiscard]] friend inline AVXLanes operator+(AVXLanes a, AVXLanes b) { return { _mm256_add_ps(a.m_value, b.m_value) }; }
+    [[nodiscard]] friend inline AVXLanes operator-(AVXLanes a, AVXLanes b) { return { _mm256_sub_ps(a.m_value, b.m_value) }; }
+    [[nodiscard]] friend inline AVXLanes operator*(AVXLanes a, AVXLanes b) { return { _mm256_mul_ps(a.m_value, b.m_value) }; }
+    [[nodiscard]] friend inline AVXLanes inverseSqrt(AVXLanes a) { return { _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(a.m_value)) }; }
+};
+
+static inline void storeMatrices(const AVXLanes (&m)[16], glm::mat4* worlds)
+{
+    for (int c = 0; c < 4; c++) {
+        __m256 row0 = m[c * 4].m_value, row1 = m[c * 4 + 1].m_value, row2 = m[c * 4 + 2].m_value, row3 = m[c * 4 + 3].m_value;
+
+        storeColumns(_mm256_castps256_ps128(row0), _mm256_castps256_ps128(row1), _mm256_castps256_ps128(row2), _mm256_castps256_ps128(row3), worlds, c);
+        storeColumns(_mm256_extractf128_ps(row0, 1), _mm256_extractf128_ps(row1, 1), _mm256_extractf128_ps(row2, 1), _mm256_extractf128_ps(row3, 1), worlds + 4, c);
+    }
+}
+
+typedef AVXLanes SimdLanes;
+static constexpr const char* INSTRUCTION_SET = "AVX2";
+#elif defined(TRANSFORM_KERNELS_SSE2)
+typedef SSELanes SimdLanes;
+static constexpr const char* INSTRUCTION_SET = "SSE2";
+#else
+typedef ScalarLanes SimdLanes;
+static constexpr const char* INSTRUCTION_SET = "scalar";
+#endif
+
+template<typename Lanes>
+static void composeLanes(const TransformSoA& transforms, glm::mat4* worlds, size_t first, size_t last)
+{
+    typedef TransformSoA Soa;
+
+    const Lanes zero = Lanes::broadcast(0.0f);
+    const Lanes one = Lanes::broadcast(1.0f);
+
+    for (size_t i = first; i < last; i += Lanes::WIDTH) {
+        Lanes x = Lanes::load(transforms.stream(Soa::ORIENTATION_X) + i);
+        Lanes y = Lanes::load(transforms.stream(Soa::ORIENTATION_Y) + i);
+        Lanes z = Lanes::load(transforms.stream(Soa::ORIENTATION_Z) + i);
+        Lanes w = Lanes::load(transforms.stream(Soa::ORIENTATION_W) + i);
+        Lanes scaleX = Lanes::load(transforms.stream(Soa::SCALE_X) + i);
+        Lanes scaleY = Lanes::load(transforms.stream(Soa::SCALE_Y) + i);
+        Lanes scaleZ = Lanes::load(transforms.stream(Soa::SCALE_Z) + i);
+
+        Lanes x2 = x + x, y2 = y + y, z2 = z + z;
+        Lanes xx = x * x2, yy = y * y2, zz = z * z2;
+        Lanes xy = x * y2, xz = x * z2, yz = y * z2;
+        Lanes wx = w * x2, wy = w * y2, wz = w * z2;
+
+        // column major, same layout as glm::mat4
+        const Lanes m[16]{
+            (one - (yy + zz)) * scaleX,
+            (xy + wz) * scaleX,
+            (xz - wy) * scaleX,
+            zero,
+            (xy - wz) * scaleY,
+            (one - (xx + zz)) * scaleY,
+            (yz + wx) * scaleY,
+            zero,
+            (xz + wy) * scaleZ,
+            (yz - wx) * scaleZ,
+            (one - (xx + yy)) * scaleZ,
+            zero,
+            Lanes::load(transforms.stream(Soa::POSITION_X) + i),
+            Lanes::load(transforms.stream(Soa::POSITION_Y) + i),
+            Lanes::load(transforms.stream(Soa::POSITION_Z) + i),
+            one,
+        };
+
+        storeMatrices(m, worlds + i);
+    }
+}
+
+template<typename Lanes>
+static void integrateLanes(TransformSoA& transforms, float delta, size_t first, size_t last)
+{
+    typedef TransformSoA Soa;
+
+    const Lanes dt = Lanes::broadcast(delta);
+    const Lanes halfDt = Lanes::broadcast(0.5f * delta);
+
+    for (size_t i = first; i < last; i += Lanes::WIDTH) {
+        for (size_t axis = 0; axis < 3; axis++) {
+            float* position = transforms.stream(static_cast<Soa::Stream>(Soa::POSITION_X + axis)) + i;
+            const float* linear = transforms.stream(static_cast<Soa::Stream>(Soa::LINEAR_X + axis)) + i;
+
+            (Lanes::load(position) + Lanes::load(linear) * dt).store(position);
+        }
+
+        float* orientation[4]{
+            transforms.stream(Soa::ORIENTATION_X) + i,
+            transforms.stream(Soa::ORIENTATION_Y) + i,
+            transforms.stream(Soa::ORIENTATION_Z) + i,
+            transforms.stream(Soa::ORIENTATION_W) + i,
+        };
+
+        Lanes x = Lanes::load(orientation[0]), y = Lanes::load(orientation[1]), z = Lanes::load(orientation[2]), w = Lanes::load(orientation[3]);
+        Lanes ax = Lanes::load(transforms.stream(Soa::ANGULAR_X) + i);
+        Lanes ay = Lanes::load(transforms.stream(Soa::ANGULAR_Y) + i);
+        Lanes az = Lanes::load(transforms.stream(Soa::ANGULAR_Z) + i);
+
+        // q += 0.5 * dt * (angular, 0) * q, then renormalize
+        Lanes nx = x + halfDt * (w * ax + (ay * z - az * y));
+        Lanes ny = y + halfDt * (w * ay + (az * x - ax * z));
+        Lanes nz = z + halfDt * (w * az + (ax * y - ay * x));
+        Lanes nw = w - halfDt * (ax * x + ay * y + az * z);
+        Lanes scale = inverseSqrt(nx * nx + ny * ny + nz * nz + nw * nw);
+
+        (nx * scale).store(orientation[0]);
+        (ny * scale).store(orientation[1]);
+        (nz * scale).store(orientation[2]);
+        (nw * scale).store(orientation[3]);
+    }
+}
+
+void composeWorldMatrices(const TransformSoA& transforms, glm::mat4* worlds)
+{
+    // matrices aren't padded, the tail goes through the scalar path
+    size_t blocks = transforms.size() / SimdLanes::WIDTH * SimdLanes::WIDTH;
+
+    composeLanes<SimdLanes>(transforms, worlds, 0, blocks);
+    composeLanes<ScalarLanes>(transforms, worlds, blocks, transforms.size());
+}
+
+void composeWorldMatricesScalar(const TransformSoA& transforms, glm::mat4* worlds)
+{
+    composeLanes<ScalarLanes>(transforms, worlds, 0, transforms.size());
+}
+
+void integrateVelocities(TransformSoA& transforms, float delta)
+{
+    // the padding is left alone, renormalizing its zero quaternions would fill it with NaNs
+    size_t blocks = transforms.size() / SimdLanes::WIDTH * SimdLanes::WIDTH;
+
+    integrateLanes<SimdLanes>(transforms, delta, 0, blocks);
+    integrateLanes<ScalarLanes>(transforms, delta, blocks, transforms.size());
+}
+
+void integrateVelocitiesScalar(TransformSoA& transforms, float delta)
+{
+    integrateLanes<ScalarLanes>(transforms, delta, 0, transforms.size());
+}
+
+const char* transformKernelsInstructionSet()
+{
+    return INSTRUCTION_SET;
+}
@@ -0,0 +1,37 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "TransformSoA.hpp"
+
+#include <glmNoIW.h>
+
+// Batch kernels over a TransformSoA. The widest instruction set the build targets is
+// picked at compile time (AVX2 with -DENABLE_AVX2=ON, SSE2 on any x86-64, scalar
+// elsewhere), the *Scalar versions are always available as a reference.
+
+// worlds[i] = translate(position) * mat4_cast(orientation) * scale(scale) for every entry,
+// worlds needs room for transforms.size() matrices
+void composeWorldMatrices(const TransformSoA& transforms, glm::mat4* worlds);
+void composeWorldMatricesScalar(const TransformSoA& transforms, glm::mat4* worlds);
+
+// moves every entry along its linear velocity and rotates it by its angular velocity
+void integrateVelocities(TransformSoA& transforms, float delta);
+void integrateVelocitiesScalar(TransformSoA& transforms, float delta);
+
+// name of the instruction set the kernels were compiled for
+[[nodiscard]] const char* transformKernelsInstructionSet();
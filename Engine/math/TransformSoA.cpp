@@ -0,0 +1,105 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "TransformSoA.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+TransformSoA::TransformSoA(size_t count)
+{
+    resize(count);
+}
+
+TransformSoA::~TransformSoA()
+{
+    ::operator delete(m_memory, std::align_val_t{ CACHE_LINE });
+}
+
+void TransformSoA::resize(size_t count)
+{
+    size_t stride = (count + STREAM_PADDING - 1) / STREAM_PADDING * STREAM_PADDING;
+
+    if (stride != m_stride) {
+        size_t bytes = std::max<size_t>(stride * STREAM_COUNT * sizeof(float), CACHE_LINE);
+        float* memory = static_cast<float*>(::operator new(bytes, std::align_val_t{ CACHE_LINE }));
+        std::memset(memory, 0, bytes);
+
+        for (size_t s = 0; s < STREAM_COUNT && m_memory != nullptr; s++) {
+            std::memcpy(memory + s * stride, m_memory + s * m_stride, std::min(count, m_size) * sizeof(float));
+        }
+
+        ::operator delete(m_memory, std::align_val_t{ CACHE_LINE });
+        m_memory = memory;
+        m_stride = stride;
+    } else {// entries dropped by an earlier shrink still hold their values
+        size_t first = std::min(count, m_size);
+        size_t last = std::max(count, m_size);
+
+        for (size_t s = 0; s < STREAM_COUNT && first < last; s++) {
+            std::memset(m_memory + s * m_stride + first, 0, (last - first) * sizeof(float));
+        }
+    }
+
+    m_size = count;
+}
+
+void TransformSoA::load(std::span<const Transform> transforms, size_t first)
+{
+    for (size_t i = 0; i < transforms.size(); i++) {
+        const Transform& transform = transforms[i];
+        size_t index = first + i;
+
+        stream(POSITION_X)[index] = transform.m_position.x;
+        stream(POSITION_Y)[index] = transform.m_position.y;
+        stream(POSITION_Z)[index] = transform.m_position.z;
+        stream(ORIENTATION_X)[index] = transform.m_orientation.x;
+        stream(ORIENTATION_Y)[index] = transform.m_orientation.y;
+        stream(ORIENTATION_Z)[index] = transform.m_orientation.z;
+        stream(ORIENTATION_W)[index] = transform.m_orientation.w;
+        stream(SCALE_X)[index] = transform.m_scale.x;
+        stream(SCALE_Y)[index] = transform.m_scale.y;
+        stream(SCALE_Z)[index] = transform.m_scale.z;
+    }
+}
+
+void TransformSoA::load(std::span<const Velocity> velocities, size_t first)
+{
+    for (size_t i = 0; i < velocities.size(); i++) {
+        const Velocity& velocity = velocities[i];
+        size_t index = first + i;
+
+        stream(LINEAR_X)[index] = velocity.m_linear.x;
+        stream(LINEAR_Y)[index] = velocity.m_linear.y;
+        stream(LINEAR_Z)[index] = velocity.m_linear.z;
+        stream(ANGULAR_X)[index] = velocity.m_angular.x;
+        stream(ANGULAR_Y)[index] = velocity.m_angular.y;
+        stream(ANGULAR_Z)[index] = velocity.m_angular.z;
+    }
+}
+
+void TransformSoA::store(std::span<Transform> transforms, size_t first) const
+{
+    for (size_t i = 0; i < transforms.size(); i++) {
+        Transform& transform = transforms[i];
+        size_t index = first + i;
+
+        transform.m_position = glm::vec3(stream(POSITION_X)[index], stream(POSITION_Y)[index], stream(POSITION_Z)[index]);
+        transform.m_orientation = glm::quat(stream(ORIENTATION_W)[index], stream(ORIENTATION_X)[index], stream(ORIENTATION_Y)[index], stream(ORIENTATION_Z)[index]);
+        transform.m_scale = glm::vec3(stream(SCALE_X)[index], stream(SCALE_Y)[index], stream(SCALE_Z)[index]);
+    }
+}
@@ -0,0 +1,82 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "../components/Transform.hpp"
+#include "../components/Velocity.hpp"
+
+#include <cstddef>
+#include <span>
+
+// Structure of arrays copy of Transforms and their Velocities for the batch kernels in
+// TransformKernels.hpp. Every stream starts on its own cache line and is padded to a
+// multiple of STREAM_PADDING floats, so full width vector loads never leave the stream.
+class TransformSoA
+{
+  public:
+    enum Stream : size_t
+    {
+        POSITION_X,
+        POSITION_Y,
+        POSITION_Z,
+        ORIENTATION_X,
+        ORIENTATION_Y,
+        ORIENTATION_Z,
+        ORIENTATION_W,
+        SCALE_X,
+        SCALE_Y,
+        SCALE_Z,
+        LINEAR_X,
+        LINEAR_Y,
+        LINEAR_Z,
+        ANGULAR_X,
+        ANGULAR_Y,
+        ANGULAR_Z,
+        STREAM_COUNT
+    };
+
+    static constexpr size_t CACHE_LINE = 64;
+    static constexpr size_t STREAM_PADDING = CACHE_LINE / sizeof(float);
+
+    TransformSoA() = default;
+    explicit TransformSoA(size_t count);
+    ~TransformSoA();
+
+    TransformSoA(const TransformSoA&) = delete;
+    void operator=(const TransformSoA&) = delete;
+
+    // keeps the first min(size, count) entries, new entries are zeroed
+    void resize(size_t count);
+
+    [[nodiscard]] constexpr size_t size() const { return m_size; }
+
+    // size rounded up to the padding, kernels may process this many entries
+    [[nodiscard]] constexpr size_t paddedSize() const { return m_stride; }
+
+    [[nodiscard]] inline float* stream(Stream stream) { return m_memory + stream * m_stride; }
+    [[nodiscard]] inline const float* stream(Stream stream) const { return m_memory + stream * m_stride; }
+
+    // copies between the AoS components and entries [first, first + span size)
+    void load(std::span<const Transform> transforms, size_t first = 0);
+    void load(std::span<const Velocity> velocities, size_t first = 0);
+    void store(std::span<Transform> transforms, size_t first = 0) const;
+
+  private:
+    float* m_memory = nullptr;
+    size_t m_size = 0;
+    size_t m_stride = 0;
+};
@@ -0,0 +1,222 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Profiler.hpp"
+
+#ifdef ENGINE_PROFILER
+
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Zones of one thread in a chain of blocks. Only the owning thread appends, the count and
+// next pointers are published with release so endCapture can read while zones keep coming.
+struct ProfileBlock
+{
+    std::array<Profiler::Zone, Profiler::ZONES_PER_BLOCK> m_zones;
+    std::atomic<uint32_t> m_count{ 0 };
+    std::atomic<ProfileBlock*> m_next{ nullptr };
+};
+
+struct ProfileThreadBuffer
+{
+    uint32_t m_id = 0;
+    std::string m_name;// guarded by s_mutex
+
+    std::atomic<uint32_t> m_capture{ 0 };// capture the blocks belong to
+    ProfileBlock m_head;
+    ProfileBlock* m_tail = &m_head;
+
+    ~ProfileThreadBuffer() { clear(); }
+
+    void clear()
+    {
+        ProfileBlock* block = m_head.m_next.load(std::memory_order_relaxed);
+
+        while (block != nullptr) {
+            ProfileBlock* next = block->m_next.load(std::memory_order_relaxed);
+            delete block;
+            block = next;
+        }
+
+        m_head.m_count.store(0, std::memory_order_relaxed);
+        m_head.m_next.store(nullptr, std::memory_order_relaxed);
+        m_tail = &m_head;
+    }
+};
+
+// buffers outlive their threads so a capture keeps zones of threads that exited
+static std::mutex s_mutex;
+static std::vector<std::unique_ptr<ProfileThreadBuffer>> s_buffers;
+static thread_local ProfileThreadBuffer* s_threadBuffer = nullptr;
+
+static uint32_t s_lastCapture = 0;
+static uint64_t s_captureStart = 0;
+
+static ProfileThreadBuffer* s_gpuBuffer = nullptr;
+
+static ProfileThreadBuffer* addBuffer(std::string name)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    s_buffers.push_back(std::make_unique<ProfileThreadBuffer>());
+    ProfileThreadBuffer* buffer = s_buffers.back().get();
+    buffer->m_id = static_cast<uint32_t>(s_buffers.size());
+    buffer->m_name = name.empty() ? "Thread " + std::to_string(buffer->m_id) : std::move(name);
+
+    return buffer;
+}
+
+static ProfileThreadBuffer& threadBuffer()
+{
+    if (s_threadBuffer == nullptr) {
+        s_threadBuffer = addBuffer({});
+    }
+
+    return *s_threadBuffer;
+}
+
+// only the thread owning the buffer appends
+static void append(ProfileThreadBuffer& buffer, uint32_t capture, const Profiler::Zone& zone)
+{
+    uint32_t bufferCapture = buffer.m_capture.load(std::memory_order_relaxed);
+
+    if (capture != bufferCapture) {
+        if (capture < bufferCapture) {// started before the capture this thread is recording
+            return;
+        }
+
+        buffer.clear();
+        buffer.m_capture.store(capture, std::memory_order_release);
+    }
+
+    ProfileBlock* block = buffer.m_tail;
+    uint32_t count = block->m_count.load(std::memory_order_relaxed);
+
+    if (count == Profiler::ZONES_PER_BLOCK) {
+        ProfileBlock* next = new ProfileBlock;
+        block->m_next.store(next, std::memory_order_release);
+        buffer.m_tail = next;
+
+        block = next;
+        count = 0;
+    }
+
+    block->m_zones[count] = zone;
+    block->m_count.store(count + 1, std::memory_order_release);
+}
+
+static void writeEscaped(std::FILE* file, const char* text)
+{
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            std::fputc('\\', file);
+        }
+
+        std::fputc(*c, file);
+    }
+}
+
+void Profiler::beginCapture()
+{
+    s_captureStart = now();
+    s_capture.store(++s_lastCapture, std::memory_order_relaxed);
+}
+
+bool Profiler::endCapture(const std::string& path)
+{
+    uint32_t capture = s_capture.exchange(0, std::memory_order_relaxed);
+    if (capture == 0) {
+        return false;
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+
+    // buffers only get reset by their threads once the next capture started, so everything
+    // in here stays put while it's written out
+    std::lock_guard<std::mutex> lock(s_mutex);
+    bool first = true;
+
+    std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    for (const auto& buffer : s_buffers) {
+        if (buffer->m_capture.load(std::memory_order_acquire) != capture) {
+            continue;
+        }
+
+        std::fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", first ? "" : ",", buffer->m_id);
+        writeEscaped(file, buffer->m_name.c_str());
+        std::fprintf(file, "\"}}");
+        first = false;
+
+        for (const ProfileBlock* block = &buffer->m_head; block != nullptr; block = block->m_next.load(std::memory_order_acquire)) {
+            uint32_t count = block->m_count.load(std::memory_order_acquire);
+
+            for (uint32_t i = 0; i < count; i++) {
+                const Zone& zone = block->m_zones[i];
+                if (zone.m_start < s_captureStart) {// gpu work submitted before the capture
+                    continue;
+                }
+
+                uint64_t start = zone.m_start - s_captureStart;
+
+                // microseconds with nanosecond digits
+                std::fprintf(file, ",\n{\"name\":\"");
+                writeEscaped(file, zone.m_name);
+                std::fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%llu.%03llu,\"dur\":%llu.%03llu}", buffer->m_id,
+                    static_cast<unsigned long long>(start / 1000), static_cast<unsigned long long>(start % 1000),
+                    static_cast<unsigned long long>((zone.m_end - zone.m_start) / 1000), static_cast<unsigned long long>((zone.m_end - zone.m_start) % 1000));
+            }
+        }
+    }
+
+    std::fprintf(file, "\n]}\n");
+    return std::fclose(file) == 0;
+}
+
+void Profiler::record(uint32_t capture, const char* name, uint64_t start, uint64_t end)
+{
+    append(threadBuffer(), capture, Zone{ name, start, end });
+}
+
+void Profiler::recordGpu(const char* name, uint64_t start, uint64_t end)
+{
+    uint32_t capture = Profiler::capture();
+    if (capture == 0) {
+        return;
+    }
+
+    if (s_gpuBuffer == nullptr) {
+        s_gpuBuffer = addBuffer("GPU");
+    }
+
+    append(*s_gpuBuffer, capture, Zone{ name, start, end });
+}
+
+void Profiler::setThreadName(std::string name)
+{
+    ProfileThreadBuffer& buffer = threadBuffer();
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    buffer.m_name = std::move(name);
+}
+
+#endif
@@ -0,0 +1,107 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+// Scoped zone CPU profiler. Build with ENABLE_PROFILER to get ENGINE_PROFILER defined, without it
+// every PROFILE_ macro expands to nothing and none of this exists.
+//
+//     PROFILE_ZONE("Physics");// from here to the end of the scope
+//
+// Zones only get recorded between Profiler::beginCapture and Profiler::endCapture, which writes
+// everything to a Chrome trace (chrome://tracing, ui.perfetto.dev). Nesting follows from the
+// timestamps. Zone names aren't copied, they have to outlive the capture.
+
+#ifdef ENGINE_PROFILER
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+class Profiler
+{
+  public:
+    static constexpr uint32_t ZONES_PER_BLOCK = 1024;
+
+    struct Zone
+    {
+        const char* m_name;
+        uint64_t m_start;// nanoseconds, see now()
+        uint64_t m_end;
+    };
+
+    [[nodiscard]] static inline uint64_t now()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // begin and end have to be called from the same thread, in turns
+    static void beginCapture();
+
+    // stops the capture and writes it as Chrome trace JSON, false if the file can't be written
+    static bool endCapture(const std::string& path);
+
+    // the capture zones starting now belong to, 0 when not capturing
+    [[nodiscard]] static inline uint32_t capture() { return s_capture.load(std::memory_order_relaxed); }
+
+    // appends to the calling thread's buffer, no locks past the thread's first zone
+    static void record(uint32_t capture, const char* name, uint64_t start, uint64_t end);
+
+    // a zone of the GPU track, with start and end already converted to now()'s clock. called by
+    // one thread at a time, whichever reads back the GPU's timestamps.
+    static void recordGpu(const char* name, uint64_t start, uint64_t end);
+
+    // shows up as the thread's name in the trace
+    static void setThreadName(std::string name);
+
+  private:
+    static inline std::atomic<uint32_t> s_capture{ 0 };
+};
+
+class ProfileZone
+{
+  public:
+    explicit ProfileZone(const char* name) : m_name{ name }, m_capture{ Profiler::capture() }, m_start{ m_capture != 0 ? Profiler::now() : 0 } {}
+
+    ~ProfileZone()
+    {
+        if (m_capture != 0) {
+            Profiler::record(m_capture, m_name, m_start, Profiler::now());
+        }
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    void operator=(const ProfileZone&) = delete;
+
+  private:
+    const char* m_name;
+    uint32_t m_capture;
+    uint64_t m_start;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __COUNTER__) { name }
+#define PROFILE_THREAD(name) Profiler::setThreadName(name)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+
+#endif
@@ -18,8 +18,9 @@
 
 #include <fstream>
 #include "Mesh.hpp"
+#include "../profiling/Profiler.hpp"
 
-void createRenderPasses(const VkDevice& device, VkFormat imageFormat, VkFormat depthFormat, VkRenderPass& renderPass)
+void createRenderPasses(const VkDevice& device, VkFormat imageFormat, VkFormat depthFormat, VkImageLayout finalLayout, VkRenderPass& renderPass)
 {
     VkAttachmentDescription attachment = {};
     attachment.format = imageFormat;
@@ -29,7 +30,7 @@ void createRenderPasses(const VkDevice& device, VkFormat imageFormat, VkFormat d
     attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    attachment.finalLayout = finalLayout;
 
     VkAttachmentReference attachmentRefs = {};
     attachmentRefs.attachment = 0;
@@ -103,6 +104,8 @@ void freeFile(char* file)
 
 VkShaderModule createShaderModule(const VkDevice& m_device, const std::string& filename)
 {
+    PROFILE_ZONE("createShaderModule");
+
     size_t codeSize;
     char* code = readFile(filename, codeSize);
 
@@ -119,7 +122,7 @@ VkShaderModule createShaderModule(const VkDevice& m_device, const std::string& f
     return shaderModule;
 }
 
-void createPipeline(const Device& device, const SwapChain& swapChain, const std::vector<VkDescriptorSetLayout>& layouts, const VkRenderPass& renderPass, VkPipelineLayout& pipelineLayout, VkPipeline& pipeline)
+void createPipeline(const Device& device, VkExtent2D extent, const std::vector<VkDescriptorSetLayout>& layouts, const VkRenderPass& renderPass, VkPipelineLayout& pipelineLayout, VkPipeline& pipeline)
 {
     VkShaderModule vertexShader = createShaderModule(device.device(), "./shaders/basic.vert.spv");
     VkShaderModule fragmentShader = createShaderModule(device.device(), "./shaders/basic.frag.spv");
@@ -156,14 +159,14 @@ void createPipeline(const Device& device, const SwapChain& swapChain, const std:
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = static_cast<float>(swapChain.extent().width);
-    viewport.height = static_cast<float>(swapChain.extent().height);
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
 
     VkRect2D scissor{};
     scissor.offset = { 0, 0 };
-    scissor.extent = swapChain.extent();
+    scissor.extent = extent;
 
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
@@ -256,10 +259,14 @@ void createPipeline(const Device& device, const SwapChain& swapChain, const std:
     vkDestroyShaderModule(device.device(), fragmentShader, nullptr);
 }
 
-BasicRasterPipeline::BasicRasterPipeline(Device& device, const SwapChain& swapChain, const std::vector<VkDescriptorSetLayout>& layouts) : m_parentDev{ device.device() }
+BasicRasterPipeline::BasicRasterPipeline(Device& device, const SwapChain& swapChain, const std::vector<VkDescriptorSetLayout>& layouts) : BasicRasterPipeline(device, swapChain.imageFormat(), swapChain.extent(), VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, layouts)
+{
+}
+
+BasicRasterPipeline::BasicRasterPipeline(Device& device, VkFormat imageFormat, VkExtent2D extent, VkImageLayout finalLayout, const std::vector<VkDescriptorSetLayout>& layouts) : m_parentDev{ device.device() }
 {
-    createRenderPasses(m_parentDev, swapChain.imageFormat(), device.getDepthFormat(), m_renderPass);
-    createPipeline(device, swapChain, layouts, m_renderPass, m_pipelineLayout, m_pipeline);
+    createRenderPasses(m_parentDev, imageFormat, device.getDepthFormat(), finalLayout, m_renderPass);
+    createPipeline(device, extent, layouts, m_renderPass, m_pipelineLayout, m_pipeline);
 }
 
 BasicRasterPipeline::~BasicRasterPipeline()
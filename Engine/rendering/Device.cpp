@@ -26,6 +26,9 @@ std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+// nothing is presented without a surface, so no swapchain either
+std::vector<const char*> headlessDeviceExtensions = {};
+
 void getDeviceExtensions(PhysicalDevice& device)
 {
     uint32_t extensionCount;
@@ -44,10 +47,17 @@ void findQueueFamilies(PhysicalDevice& device, VkSurfaceKHR surface)
     for (uint32_t i = 0; i < queueFamilyCount; i++) {
         const VkQueueFamilyProperties& queueFamily = queueFamilies[i];
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device.m_physicalDevice, i, surface, &presentSupport);
+        if (surface != VK_NULL_HANDLE) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device.m_physicalDevice, i, surface, &presentSupport);
+        }
 
         if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0) {
             device.m_graphicsFamily = i;
+            device.m_timestampValidBits = queueFamily.timestampValidBits;
+
+            if (surface == VK_NULL_HANDLE) {// headless, the present queue is never used
+                device.m_presentFamily = i;
+            }
         }
 
         if (presentSupport) {
@@ -86,7 +96,10 @@ void readPhysicalDevice(VkPhysicalDevice vkDeviceIn, VkSurfaceKHR surface, Physi
     deviceOut.m_physicalDevice = vkDeviceIn;
     getDeviceExtensions(deviceOut);
     findQueueFamilies(deviceOut, surface);
-    querySwapChainSupport(deviceOut, surface);
+
+    if (surface != VK_NULL_HANDLE) {
+        querySwapChainSupport(deviceOut, surface);
+    }
 }
 
 bool checkTargetedFeatures(const PhysicalDevice& physicalDevice, const VkPhysicalDeviceFeatures& targetFeatures)
@@ -107,7 +120,7 @@ bool checkTargetedFeatures(const PhysicalDevice& physicalDevice, const VkPhysica
     return true;
 }
 
-bool checkExtensionSupport(const PhysicalDevice& physicalDevice)
+bool checkExtensionSupport(const PhysicalDevice& physicalDevice, const std::vector<const char*>& extensions)
 {
     std::set<std::string> extensionNames;
 
@@ -115,7 +128,7 @@ bool checkExtensionSupport(const PhysicalDevice& physicalDevice)
         extensionNames.emplace(extension.extensionName);
     }
 
-    for (auto devExtension : deviceExtensions) {
+    for (auto devExtension : extensions) {
         if (!extensionNames.contains(devExtension)) {
             return false;
         }
@@ -124,12 +137,16 @@ bool checkExtensionSupport(const PhysicalDevice& physicalDevice)
     return true;
 }
 
-bool isSuitable(const PhysicalDevice& physicalDevice, const VkPhysicalDeviceFeatures& targetFeatures)
+bool isSuitable(const PhysicalDevice& physicalDevice, const VkPhysicalDeviceFeatures& targetFeatures, bool headless)
 {
-    return checkTargetedFeatures(physicalDevice, targetFeatures) && checkExtensionSupport(physicalDevice) && physicalDevice.m_graphicsFamily.has_value() && physicalDevice.m_presentFamily.has_value() && !physicalDevice.m_formats.empty() && !physicalDevice.m_presentModes.empty();
+    if (headless) {
+        return checkTargetedFeatures(physicalDevice, targetFeatures) && checkExtensionSupport(physicalDevice, headlessDeviceExtensions) && physicalDevice.m_graphicsFamily.has_value();
+    }
+
+    return checkTargetedFeatures(physicalDevice, targetFeatures) && checkExtensionSupport(physicalDevice, deviceExtensions) && physicalDevice.m_graphicsFamily.has_value() && physicalDevice.m_presentFamily.has_value() && !physicalDevice.m_formats.empty() && !physicalDevice.m_presentModes.empty();
 }
 
-Device::Device(const VkInstance& context, const VkSurfaceKHR& surface, const VkPhysicalDeviceFeatures& targetFeatures)
+Device::Device(const VkInstance& context, const VkSurfaceKHR& surface, const VkPhysicalDeviceFeatures& targetFeatures) : m_headless{ surface == VK_NULL_HANDLE }
 {
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(context, &deviceCount, nullptr);
@@ -144,7 +161,7 @@ Device::Device(const VkInstance& context, const VkSurfaceKHR& surface, const VkP
 
     for (auto physDev : devices) {
         readPhysicalDevice(physDev, surface, m_physDevice);
-        if (isSuitable(m_physDevice, targetFeatures)) {
+        if (isSuitable(m_physDevice, targetFeatures, m_headless)) {
             break;
         } else {
             m_physDevice.m_physicalDevice = VK_NULL_HANDLE;
@@ -179,8 +196,9 @@ Device::Device(const VkInstance& context, const VkSurfaceKHR& surface, const VkP
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(num_queues);
     createInfo.pEnabledFeatures = VK_NULL_HANDLE;
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    const std::vector<const char*>& extensions = m_headless ? headlessDeviceExtensions : deviceExtensions;
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
 #ifndef NDEBUG
     createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -32,6 +32,7 @@ struct PhysicalDevice
 
     std::optional<uint32_t> m_graphicsFamily;
     std::optional<uint32_t> m_presentFamily;
+    uint32_t m_timestampValidBits = 0;// of the graphics family, 0 without timestamp support
     VkSurfaceCapabilitiesKHR m_capabilities;
     std::vector<VkSurfaceFormatKHR> m_formats;
     std::vector<VkPresentModeKHR> m_presentModes;
@@ -40,9 +41,12 @@ struct PhysicalDevice
 class Device
 {
   public:
+    // a null surface makes a headless device, one that can't present
     Device(const VkInstance& context, const VkSurfaceKHR& surface, const VkPhysicalDeviceFeatures& targetFeatures);
     ~Device();
 
+    [[nodiscard]] constexpr bool headless() const { return m_headless; }
+
     [[nodiscard]] constexpr const PhysicalDevice& physicalDevice() const { return m_physDevice; }
     [[nodiscard]] constexpr const VkDevice& device() const { return m_logicalDevice; }
     [[nodiscard]] constexpr const VkQueue& graphicsQueue() const { return m_graphicsQueue; }
@@ -59,6 +63,7 @@ class Device
 
   private:
     PhysicalDevice m_physDevice;
+    bool m_headless;
 
     VkDevice m_logicalDevice;
     VkQueue m_graphicsQueue;
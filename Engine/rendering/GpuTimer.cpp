@@ -0,0 +1,194 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "GpuTimer.hpp"
+#include "../profiling/Profiler.hpp"
+
+#include <chrono>
+
+static uint64_t cpuNanoseconds()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+GpuTimer::GpuTimer(const Device& device, uint32_t framesInFlight, std::vector<const char*> passNames) : m_device{ device },
+                                                                                                         m_passNames{ std::move(passNames) },
+                                                                                                         m_pending(framesInFlight, 0),
+                                                                                                         m_frameNumbers(framesInFlight, 0),
+                                                                                                         m_passNanoseconds{ std::make_unique<std::atomic<uint64_t>[]>(m_passNames.size()) }
+{
+    uint32_t validBits = device.physicalDevice().m_timestampValidBits;
+    if (validBits == 0) {
+        spdlog::warn("The graphics queue doesn't support timestamps, no GPU timings.");
+        return;
+    }
+
+    m_validMask = validBits >= 64 ? ~uint64_t(0) : (uint64_t(1) << validBits) - 1;
+    m_nanosecondsPerTick = static_cast<double>(device.properties().limits.timestampPeriod);
+
+    uint32_t markersPerFrame = passCount() + 1;
+
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = markersPerFrame;
+
+    m_pools.resize(framesInFlight);
+    for (VkQueryPool& pool : m_pools) {
+        ASSERT_VK_SUCCESS(vkCreateQueryPool(m_device.device(), &poolInfo, nullptr, &pool), "Failed to create timestamp query pool!");
+    }
+
+    m_markers.resize(framesInFlight * markersPerFrame);
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_device.graphicsPool();
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = static_cast<uint32_t>(m_markers.size());
+
+    ASSERT_VK_SUCCESS(vkAllocateCommandBuffers(m_device.device(), &allocInfo, m_markers.data()), "Failed to allocate timestamp command buffers!");
+
+    // the markers never change, they're recorded once
+    for (uint32_t frame = 0; frame < framesInFlight; frame++) {
+        for (uint32_t index = 0; index < markersPerFrame; index++) {
+            VkCommandBuffer commandBuffer = marker(frame, index);
+
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            ASSERT_VK_SUCCESS(vkBeginCommandBuffer(commandBuffer, &beginInfo), "Failed to begin timestamp command buffer!");
+
+            if (index == 0) {
+                vkCmdResetQueryPool(commandBuffer, m_pools[frame], 0, markersPerFrame);
+                vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_pools[frame], 0);
+            } else {// once everything submitted before is done
+                vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_pools[frame], index);
+            }
+
+            ASSERT_VK_SUCCESS(vkEndCommandBuffer(commandBuffer), "Failed to record timestamp command buffer!");
+        }
+    }
+
+    calibrate();
+}
+
+GpuTimer::~GpuTimer()
+{
+    if (!m_markers.empty()) {
+        vkFreeCommandBuffers(m_device.device(), m_device.graphicsPool(), static_cast<uint32_t>(m_markers.size()), m_markers.data());
+    }
+
+    for (VkQueryPool pool : m_pools) {
+        vkDestroyQueryPool(m_device.device(), pool, nullptr);
+    }
+}
+
+void GpuTimer::calibrate()
+{
+    // Writes one timestamp and waits for it, the CPU clock halfway between submitting and the
+    // wait returning is taken as the moment it got written. Good to a fraction of a submission's
+    // latency, plenty to line passes up with CPU zones.
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_markers[0];
+
+    uint64_t before = cpuNanoseconds();
+    ASSERT_VK_SUCCESS(vkQueueSubmit(m_device.graphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE), "Failed to submit timestamp calibration!");
+    vkQueueWaitIdle(m_device.graphicsQueue());
+    uint64_t after = cpuNanoseconds();
+
+    uint64_t ticks = 0;
+    ASSERT_VK_SUCCESS(vkGetQueryPoolResults(m_device.device(), m_pools[0], 0, 1, sizeof(ticks), &ticks, sizeof(ticks), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT), "Failed to read timestamp calibration!");
+
+    uint64_t cpu = before + (after - before) / 2;
+    m_offset = static_cast<int64_t>(cpu) - static_cast<int64_t>(static_cast<double>(ticks & m_validMask) * m_nanosecondsPerTick);
+}
+
+uint64_t GpuTimer::toCpuNanoseconds(uint64_t ticks) const
+{
+    return static_cast<uint64_t>(m_offset + static_cast<int64_t>(static_cast<double>(ticks) * m_nanosecondsPerTick));
+}
+
+void GpuTimer::submitted(uint32_t frame)
+{
+    if (supported()) {
+        m_pending[frame] = 1;
+        m_frameNumbers[frame] = m_submittedFrames++;
+    }
+}
+
+void GpuTimer::collectAll()
+{
+    for (uint32_t frame = 0; frame < m_pending.size(); frame++) {
+        collect(frame);
+    }
+}
+
+void GpuTimer::setHistory(std::vector<double>* history)
+{
+    m_history = history;
+    m_historyStart = m_submittedFrames;
+}
+
+void GpuTimer::collect(uint32_t frame)
+{
+    if (!m_pending[frame]) {
+        return;
+    }
+
+    m_pending[frame] = 0;
+
+    // a timestamp followed by its availability, no WAIT bit so this never blocks
+    uint32_t markersPerFrame = passCount() + 1;
+    std::vector<uint64_t> results(markersPerFrame * 2);
+
+    VkResult result = vkGetQueryPoolResults(m_device.device(), m_pools[frame], 0, markersPerFrame, results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (result != VK_SUCCESS && result != VK_NOT_READY) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < markersPerFrame; i++) {
+        if (results[i * 2 + 1] == 0) {
+            return;// the frame's fence should have made sure of this, skip it rather than wait
+        }
+    }
+
+    uint64_t first = results[0] & m_validMask;
+    uint64_t frameNanoseconds = 0;
+
+    for (uint32_t pass = 0; pass < passCount(); pass++) {
+        // relative to the first marker, so a counter wrapping around mid frame comes out right
+        uint64_t start = ((results[pass * 2] & m_validMask) - first) & m_validMask;
+        uint64_t end = ((results[(pass + 1) * 2] & m_validMask) - first) & m_validMask;
+        uint64_t nanoseconds = static_cast<uint64_t>(static_cast<double>(end - start) * m_nanosecondsPerTick);
+
+        m_passNanoseconds[pass].store(nanoseconds, std::memory_order_relaxed);
+        frameNanoseconds += nanoseconds;
+
+#ifdef ENGINE_PROFILER
+        Profiler::recordGpu(m_passNames[pass], toCpuNanoseconds(first + start), toCpuNanoseconds(first + end));
+#endif
+    }
+
+    m_frameNanoseconds.store(frameNanoseconds, std::memory_order_relaxed);
+
+    if (m_history != nullptr && m_frameNumbers[frame] >= m_historyStart) {
+        uint64_t index = m_frameNumbers[frame] - m_historyStart;
+        if (index < m_history->size()) {
+            (*m_history)[index] = static_cast<double>(frameNanoseconds) / 1000000.0;
+        }
+    }
+}
@@ -0,0 +1,94 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "../utils.hpp"
+#include "Device.hpp"
+
+// GPU time per pass from timestamp queries. Every frame in flight has its own query pool and,
+// per marker, a tiny command buffer writing one timestamp. The markers get submitted in between
+// the passes' command buffers,
+//
+//     marker 0, pass 0, marker 1, pass 1, ..., marker n
+//
+// so the cached pass command buffers don't need to know about the queries. A frame's results
+// are read when its slot comes around again, after its fence signalled, so reading never stalls.
+class GpuTimer
+{
+  public:
+    GpuTimer(const Device& device, uint32_t framesInFlight, std::vector<const char*> passNames);
+    ~GpuTimer();
+
+    // false when the graphics queue can't write timestamps, everything else is a no-op then
+    [[nodiscard]] constexpr bool supported() const { return m_validMask != 0; }
+
+    [[nodiscard]] inline uint32_t passCount() const { return static_cast<uint32_t>(m_passNames.size()); }
+    [[nodiscard]] inline const char* passName(uint32_t pass) const { return m_passNames[pass]; }
+
+    // the command buffer that goes in front of a pass, passCount() for the one after the last pass
+    [[nodiscard]] inline VkCommandBuffer marker(uint32_t frame, uint32_t index) const { return m_markers[frame * (passCount() + 1) + index]; }
+
+    // call right after submitting a frame's markers
+    void submitted(uint32_t frame);
+
+    // reads a frame's timestamps once its fence signalled, before it gets submitted again.
+    // adds the passes to the profiler's GPU track when capturing.
+    void collect(uint32_t frame);
+
+    // collects every frame still pending, the device has to be idle
+    void collectAll();
+
+    // Frame times of the frames submitted from now on also go to (*history)[i] for the i-th of
+    // them, as long as it's big enough. Written by collect(), so only read it from the thread
+    // calling that once everything got collected. nullptr stops it.
+    void setHistory(std::vector<double>* history);
+
+    // results of the last collected frame, safe to read from any thread
+    [[nodiscard]] inline double passMilliseconds(uint32_t pass) const { return static_cast<double>(m_passNanoseconds[pass].load(std::memory_order_relaxed)) / 1000000.0; }
+    [[nodiscard]] inline double frameMilliseconds() const { return static_cast<double>(m_frameNanoseconds.load(std::memory_order_relaxed)) / 1000000.0; }
+
+    DELETE_COPY_AND_MOVE(GpuTimer);
+
+  private:
+    const Device& m_device;
+    std::vector<const char*> m_passNames;
+
+    std::vector<VkQueryPool> m_pools;// one per frame in flight
+    std::vector<VkCommandBuffer> m_markers;// passCount() + 1 per frame in flight
+    std::vector<uint8_t> m_pending;// per frame in flight, submitted but not collected yet
+    std::vector<uint64_t> m_frameNumbers;// per frame in flight, of the last frame submitted with it
+    uint64_t m_submittedFrames = 0;
+
+    std::vector<double>* m_history = nullptr;
+    uint64_t m_historyStart = 0;// frame number of (*m_history)[0]
+
+    uint64_t m_validMask = 0;
+    double m_nanosecondsPerTick = 1.0;
+    int64_t m_offset = 0;// nanoseconds to add to converted timestamps to land on Profiler::now()'s clock
+
+    std::unique_ptr<std::atomic<uint64_t>[]> m_passNanoseconds;
+    std::atomic<uint64_t> m_frameNanoseconds{ 0 };
+
+    void calibrate();
+    [[nodiscard]] uint64_t toCpuNanoseconds(uint64_t ticks) const;
+};
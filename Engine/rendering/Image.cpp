@@ -228,6 +228,12 @@ Image::Image(const Device& device, VkExtent2D extent, VkFormat depthFormat) : m_
     transitionImageLayout(device, m_image, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
 }
 
+Image::Image(const Device& device, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage) : m_device{ device }, m_width{ extent.width }, m_height{ extent.height }
+{
+    createImage(device, extent.width, extent.height, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_image, m_memory);
+    m_imageView = createImageView(device.device(), m_image, format, VK_IMAGE_ASPECT_COLOR_BIT);
+}
+
 Image::~Image()
 {
     destroyImage(m_device.device(), m_image, m_memory, m_imageView, m_sampler);
@@ -32,6 +32,9 @@ class Image
 
     Image(const Device& device, VkExtent2D extent, VkFormat depthFormat);
 
+    // color render target, usage is added to COLOR_ATTACHMENT
+    Image(const Device& device, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage);
+
     ~Image();
 
     [[nodiscard]] constexpr const VkImage& image() const { return m_image; }
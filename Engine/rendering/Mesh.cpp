@@ -15,6 +15,7 @@
 */
 
 #include "Mesh.hpp"
+#include "../profiling/Profiler.hpp"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loaderNoIW.h"
@@ -48,6 +49,8 @@ Mesh::Mesh(Mesh&& other) : m_vertexBuf(std::move(other.m_vertexBuf)), m_indexBuf
 
 Model::Model(const char* filename)
 {
+    PROFILE_ZONE("Model::Model");
+
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
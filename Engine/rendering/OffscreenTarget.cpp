@@ -0,0 +1,76 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "OffscreenTarget.hpp"
+
+#include "VulkanUtils.hpp"
+#include "Buffer.hpp"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_writeNoIW.h>
+
+#include <spdlog/spdlog.h>
+
+static constexpr uint32_t PIXEL_SIZE = 4;
+
+OffscreenTarget::OffscreenTarget(Device& device, VkExtent2D extent, uint32_t imageCount) : m_device{ device }, m_extent{ extent }
+{
+    m_images.reserve(imageCount);
+    for (uint32_t i = 0; i < imageCount; i++) {
+        m_images.emplace_back(device, extent, m_imageFormat, VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+        m_imageViews.push_back(m_images.back().imageView());
+    }
+
+    m_depthImage = std::make_unique<Image>(device, extent, device.getDepthFormat());
+}
+
+bool OffscreenTarget::save(uint32_t index, const std::string& path) const
+{
+    VkDeviceSize size = static_cast<VkDeviceSize>(m_extent.width) * m_extent.height * PIXEL_SIZE;
+    Buffer readback{ m_device, size, 1, 1, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands(m_device.device(), m_device.graphicsPool());
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = { m_extent.width, m_extent.height, 1 };
+
+    vkCmdCopyImageToBuffer(commandBuffer, m_images[index].image(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer(), 1, &region);
+
+    // make the copy visible to the mapped pointer
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = readback.buffer();
+    barrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+    endSingleTimeCommands(m_device.device(), m_device.graphicsQueue(), m_device.graphicsPool(), commandBuffer);
+
+    int width = static_cast<int>(m_extent.width);
+    int height = static_cast<int>(m_extent.height);
+    if (stbi_write_png(path.c_str(), width, height, static_cast<int>(PIXEL_SIZE), readback.data(), width * static_cast<int>(PIXEL_SIZE)) == 0) {
+        spdlog::error("Failed to write {}", path);
+        return false;
+    }
+
+    return true;
+}
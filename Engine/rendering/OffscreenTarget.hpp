@@ -0,0 +1,57 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "Device.hpp"
+#include "Image.hpp"
+
+// Color and depth images to render into instead of a swap chain, for headless runs. The color
+// images are left in TRANSFER_SRC_OPTIMAL by the render pass so they can be read back.
+class OffscreenTarget
+{
+  public:
+    // 8 bit sRGB, what a PNG holds
+    static constexpr VkFormat FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+
+    OffscreenTarget(Device& device, VkExtent2D extent, uint32_t imageCount);
+
+    [[nodiscard]] constexpr const VkFormat& imageFormat() const { return m_imageFormat; }
+    [[nodiscard]] constexpr const VkExtent2D& extent() const { return m_extent; }
+    [[nodiscard]] constexpr const std::vector<VkImageView>& imageViews() const { return m_imageViews; }
+    [[nodiscard]] constexpr const std::unique_ptr<Image>& depthImage() const { return m_depthImage; }
+
+    // Writes image index as a PNG. It has to have been rendered at least once and nothing may
+    // be writing it, this waits for the copy.
+    bool save(uint32_t index, const std::string& path) const;
+
+    DELETE_COPY_AND_MOVE(OffscreenTarget);
+
+  private:
+    const Device& m_device;
+
+    VkFormat m_imageFormat = FORMAT;
+    VkExtent2D m_extent;
+    std::vector<Image> m_images;
+    std::vector<VkImageView> m_imageViews;
+
+    std::unique_ptr<Image> m_depthImage;
+};
@@ -33,6 +33,9 @@ class BasicRasterPipeline : public Pipeline
 {
   public:
     BasicRasterPipeline(Device& device, const SwapChain& swapChain, const std::vector<VkDescriptorSetLayout>& layouts = std::vector<VkDescriptorSetLayout>());
+
+    // renders into images of imageFormat, left in finalLayout at the end of the pass
+    BasicRasterPipeline(Device& device, VkFormat imageFormat, VkExtent2D extent, VkImageLayout finalLayout, const std::vector<VkDescriptorSetLayout>& layouts = std::vector<VkDescriptorSetLayout>());
     virtual ~BasicRasterPipeline();
 
     DELETE_COPY(BasicRasterPipeline);
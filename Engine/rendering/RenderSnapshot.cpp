@@ -0,0 +1,74 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "RenderSnapshot.hpp"
+
+bool RenderSnapshots::publish()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] { return m_closed || (!m_published && !m_drawing); });
+
+    if (m_closed) {
+        return false;
+    }
+
+    uint32_t front = m_back;
+    m_back ^= 1;
+    m_published = true;
+
+    RenderSnapshot& next = m_snapshots[m_back];
+    next = m_snapshots[front];
+    next.m_frame++;
+    next.m_cameraChanged = false;
+
+    lock.unlock();
+    m_condition.notify_all();
+    return true;
+}
+
+const RenderSnapshot* RenderSnapshots::acquire()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] { return m_closed || m_published; });
+
+    if (m_closed) {
+        return nullptr;
+    }
+
+    m_published = false;
+    m_drawing = true;
+    return &m_snapshots[m_back ^ 1];
+}
+
+void RenderSnapshots::release()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_drawing = false;
+    }
+
+    m_condition.notify_all();
+}
+
+void RenderSnapshots::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+    }
+
+    m_condition.notify_all();
+}
@@ -0,0 +1,76 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <glmNoIW.h>
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+struct CameraInfo
+{
+    glm::mat4 m_viewProjection;
+};
+
+// Everything the renderer needs from the scene for one frame. Filled by the render systems on
+// the simulation thread, so drawing it never touches the ECS.
+struct RenderSnapshot
+{
+    uint64_t m_frame = 0;
+
+    CameraInfo m_camera{ glm::mat4(1.0f) };
+    bool m_cameraChanged = false;// the uniform buffers need the new camera
+};
+
+// Double buffered handoff between the simulation thread and the render thread. The simulation
+// fills back() and publishes it, the render thread acquires the published snapshot, draws it and
+// releases it. Publishing waits for the previous snapshot to be released, so simulation runs at
+// most one frame ahead of rendering and never writes a snapshot being drawn.
+class RenderSnapshots
+{
+  public:
+    RenderSnapshots() = default;
+
+    RenderSnapshots(const RenderSnapshots&) = delete;
+    void operator=(const RenderSnapshots&) = delete;
+
+    // simulation side, the snapshot being filled
+    [[nodiscard]] constexpr RenderSnapshot& back() { return m_snapshots[m_back]; }
+
+    // hands back() over and starts the next one as a copy of it, with the change flags cleared.
+    // returns false once closed.
+    bool publish();
+
+    // render side, waits for a published snapshot, nullptr once closed
+    [[nodiscard]] const RenderSnapshot* acquire();
+    void release();
+
+    // wakes up both sides for good, callable from either
+    void close();
+
+  private:
+    std::array<RenderSnapshot, 2> m_snapshots;
+    uint32_t m_back = 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_published = false;// m_snapshots[m_back ^ 1] waits for the render thread
+    bool m_drawing = false;// the render thread holds m_snapshots[m_back ^ 1]
+    bool m_closed = false;
+};
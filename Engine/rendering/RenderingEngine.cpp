@@ -16,53 +16,68 @@
 
 #include "RenderingEngine.hpp"
 
-#include "../components/Transform.hpp"
 #include "../components/Camera.hpp"
+#include "../components/WorldTransform.hpp"
 #include "Mesh.hpp"
+#include "../profiling/Profiler.hpp"
+#include "../window.hpp"
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtx/quaternion.hpp>
 
-CameraScraper::CameraScraper(RenderingEngine& parentEngine) : m_parentEngine{ parentEngine }
+CameraScraper::CameraScraper(RenderSnapshots& snapshots) : m_snapshots{ snapshots }
 {
-    addComponentType(Transform::ID);
-    addComponentType(Camera::ID);
+    addComponentTypes<const WorldTransform, const Camera>();
 }
 
-void CameraScraper::update([[maybe_unused]] float delta, Entity_t entity)
+void CameraScraper::updateChunk([[maybe_unused]] float delta, const Archetype& archetype, const ArchetypeChunk& chunk)
 {
-    Transform& transform = *get<Transform>(entity);
-    Camera& camera = *get<Camera>(entity);
-
-    glm::mat4 projection{ glm::perspective(camera.fov, 16.0f / 9.0f, camera.nearClipPlane, camera.farClipPlane) };
-    glm::mat4 view{ glm::toMat4(glm::conjugate(transform.m_orientation)) };
+    if (!changed<WorldTransform>(archetype, chunk) && !changed<Camera>(archetype, chunk)) {
+        return;// the snapshot still holds this camera
+    }
 
-    view *= glm::translate(glm::mat4(1.0f), -transform.m_position);
+    view<const WorldTransform, const Camera>().each(archetype, chunk, [this](const WorldTransform& transform, const Camera& camera) {
+        glm::mat4 projection{ glm::perspective(camera.fov, 16.0f / 9.0f, camera.nearClipPlane, camera.farClipPlane) };
+        glm::mat4 view{ glm::inverse(transform.m_matrix) };
 
-    projection[1][1] *= -1;
-    m_parentEngine.m_mainCamera.m_viewProjection = projection * view;
+        projection[1][1] *= -1;
 
-    for (size_t i = 0; i < RenderingEngine::MAX_FRAMES_IN_FLIGHT; i++) {
-        m_parentEngine.m_globalUBO.write(&m_parentEngine.m_mainCamera, sizeof(CameraInfo), i);
-    }
+        RenderSnapshot& snapshot = m_snapshots.back();
+        snapshot.m_camera.m_viewProjection = projection * view;
+        snapshot.m_cameraChanged = true;
+    });
 }
 
-RenderingEngine::RenderingEngine(const VkSurfaceKHR& surface, Device& device) : m_device{ device },
-                                                                                m_swapChain{ std::make_unique<SwapChain>(surface, device) },
-                                                                                m_globalUBO{ device, sizeof(CameraInfo), MAX_FRAMES_IN_FLIGHT, device.physicalDevice().m_properties.limits.minUniformBufferOffsetAlignment, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT },
-                                                                                m_globalLayout{ device },
-                                                                                m_globalPool{ device }
+RenderingEngine::RenderingEngine(const Window& window, Device& device, JobSystem& jobs) : m_device{ device },
+                                                                                         m_swapChain{ window.headless() ? nullptr : std::make_unique<SwapChain>(window.surface(), device) },
+                                                                                         m_offscreen{ window.headless() ? std::make_unique<OffscreenTarget>(device, VkExtent2D{ window.width(), window.height() }, MAX_FRAMES_IN_FLIGHT) : nullptr },
+                                                                                         m_gpuTimer{ device, MAX_FRAMES_IN_FLIGHT, { "Main pass" } },
+                                                                                         m_globalUBO{ device, sizeof(CameraInfo), MAX_FRAMES_IN_FLIGHT, device.physicalDevice().m_properties.limits.minUniformBufferOffsetAlignment, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT },
+                                                                                         m_globalLayout{ device },
+                                                                                         m_globalPool{ device }
 {
+    // parse the model on a worker while the rest of the renderer gets created
+    Model monke;
+    JobCounter modelLoaded;
+    jobs.run([&monke] {
+        monke = Model{ "./res/monkey3.obj" };
+        monke.finalize();
+    },
+        &modelLoaded);
+
     m_globalLayout.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT).seal();
     std::vector<VkDescriptorSetLayout> layouts;
     layouts.push_back(m_globalLayout.layout());
-    m_basicRasterPipeline = std::make_unique<BasicRasterPipeline>(device, *m_swapChain.get(), layouts);
+    if (m_swapChain) {
+        m_basicRasterPipeline = std::make_unique<BasicRasterPipeline>(device, *m_swapChain.get(), layouts);
+    } else {// left ready to be copied out by saveFrame()
+        m_basicRasterPipeline = std::make_unique<BasicRasterPipeline>(device, m_offscreen->imageFormat(), m_offscreen->extent(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, layouts);
+    }
 
     m_globalPool.setMaxSets(MAX_FRAMES_IN_FLIGHT).addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, MAX_FRAMES_IN_FLIGHT).seal();
 
     m_imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
     m_renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
     m_inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    m_imagesInFlight.resize(m_swapChain->images().size(), VK_NULL_HANDLE);
+    m_imagesInFlight.resize(m_swapChain ? m_swapChain->images().size() : m_offscreen->imageViews().size(), VK_NULL_HANDLE);
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -78,7 +93,11 @@ RenderingEngine::RenderingEngine(const VkSurfaceKHR& surface, Device& device) :
         ASSERT_VK_SUCCESS(vkCreateFence(m_device.device(), &fenceInfo, nullptr, &m_inFlightFences[i]), semaphore_error);
     }
 
-    ASSERT_VK_SUCCESS(vkAcquireNextImageKHR(m_device.device(), m_swapChain->swapChain(), UINT64_MAX, m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &m_imageIndex), "Failed to acquire swap chain image!");
+    if (m_swapChain) {
+        ASSERT_VK_SUCCESS(vkAcquireNextImageKHR(m_device.device(), m_swapChain->swapChain(), UINT64_MAX, m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &m_imageIndex), "Failed to acquire swap chain image!");
+    } else {// every frame in flight has an image of its own
+        m_imageIndex = static_cast<uint32_t>(m_currentFrame);
+    }
 
     m_imagesInFlight[m_imageIndex] = m_inFlightFences[m_currentFrame];
 
@@ -105,9 +124,7 @@ RenderingEngine::RenderingEngine(const VkSurfaceKHR& surface, Device& device) :
         descWriter.createAndWrite(m_globalSets[i]);
     }
 
-    Model monke{ "./res/monkey3.obj" };
-    monke.finalize();
-
+    jobs.wait(modelLoaded);
     m_monkey = std::make_unique<Mesh>(m_device, monke.getVertices(), monke.getIndices());
 }
 
@@ -142,7 +159,7 @@ void RenderingEngine::recordCommandBuffer(uint32_t cbfIndex)
     renderPassInfo.renderPass = m_basicRasterPipeline->m_renderPass;
     renderPassInfo.framebuffer = m_framebuffers[cbfIndex];
     renderPassInfo.renderArea.offset = { 0, 0 };
-    renderPassInfo.renderArea.extent = m_swapChain->extent();
+    renderPassInfo.renderArea.extent = extent();
 
     std::array<VkClearValue, 2> clearValues{};
     clearValues[0].color = { .float32 = { 0.f, 0.f, 0.f, 1.f } };
@@ -157,14 +174,14 @@ void RenderingEngine::recordCommandBuffer(uint32_t cbfIndex)
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = static_cast<float>(m_swapChain->extent().width);
-    viewport.height = static_cast<float>(m_swapChain->extent().height);
+    viewport.width = static_cast<float>(extent().width);
+    viewport.height = static_cast<float>(extent().height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
 
     VkRect2D scissor{};
     scissor.offset = { 0, 0 };
-    scissor.extent = m_swapChain->extent();
+    scissor.extent = extent();
 
     vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
     vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
@@ -184,12 +201,15 @@ void RenderingEngine::recordCommandBuffer(uint32_t cbfIndex)
 
 void RenderingEngine::createFramebuffers()
 {
-    m_framebuffers.resize(m_swapChain->imageViews().size());
+    const std::vector<VkImageView>& imageViews = m_swapChain ? m_swapChain->imageViews() : m_offscreen->imageViews();
+    const Image& depthImage = m_swapChain ? *m_swapChain->depthImage() : *m_offscreen->depthImage();
+
+    m_framebuffers.resize(imageViews.size());
 
-    for (size_t i = 0; i < m_swapChain->imageViews().size(); i++) {
+    for (size_t i = 0; i < imageViews.size(); i++) {
         std::array<VkImageView, 2> attachments = {
-            m_swapChain->imageViews()[i],
-            m_swapChain->depthImage()->imageView()
+            imageViews[i],
+            depthImage.imageView()
         };
 
         VkFramebufferCreateInfo framebufferInfo{};
@@ -197,8 +217,8 @@ void RenderingEngine::createFramebuffers()
         framebufferInfo.renderPass = m_basicRasterPipeline->m_renderPass;
         framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
         framebufferInfo.pAttachments = attachments.data();
-        framebufferInfo.width = m_swapChain->extent().width;
-        framebufferInfo.height = m_swapChain->extent().height;
+        framebufferInfo.width = extent().width;
+        framebufferInfo.height = extent().height;
         framebufferInfo.layers = 1;
 
         ASSERT_VK_SUCCESS(vkCreateFramebuffer(m_device.device(), &framebufferInfo, nullptr, &m_framebuffers[i]), "failed to create framebuffer!");
@@ -220,8 +240,19 @@ void RenderingEngine::resize()
     invalidateCommandBuffers();
 }
 
-void RenderingEngine::render()
+void RenderingEngine::render(const RenderSnapshot& snapshot)
 {
+    PROFILE_ZONE("RenderingEngine::render");
+
+    // present() left the queue idle, so no frame in flight reads the uniform buffers
+    if (snapshot.m_cameraChanged) {
+        m_mainCamera = snapshot.m_camera;
+
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            m_globalUBO.write(&m_mainCamera, sizeof(CameraInfo), i);
+        }
+    }
+
     // FIXME: bad style, remove nested if's
     if (m_commandBuffersInvalidated) {
         if (m_startingCBUpdateIndex == static_cast<uint32_t>(-1)) {
@@ -238,23 +269,43 @@ void RenderingEngine::render()
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+    // offscreen images aren't acquired or presented, the fences are all the syncing they need
     VkSemaphore waitSemaphores[] = { m_imageAvailableSemaphores[m_currentFrame] };
     VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = m_swapChain ? 1 : 0;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_commandBuffers[m_imageIndex];
-    submitInfo.signalSemaphoreCount = 1;
+
+    // the pass bracketed by the timestamp markers
+    std::array<VkCommandBuffer, 3> commandBuffers{};
+    if (m_gpuTimer.supported()) {
+        uint32_t frame = static_cast<uint32_t>(m_currentFrame);
+        commandBuffers = { m_gpuTimer.marker(frame, 0), m_commandBuffers[m_imageIndex], m_gpuTimer.marker(frame, 1) };
+        submitInfo.commandBufferCount = 3;
+    } else {
+        commandBuffers[0] = m_commandBuffers[m_imageIndex];
+        submitInfo.commandBufferCount = 1;
+    }
+
+    submitInfo.pCommandBuffers = commandBuffers.data();
+    submitInfo.signalSemaphoreCount = m_swapChain ? 1 : 0;
     submitInfo.pSignalSemaphores = &m_renderFinishedSemaphores[m_currentFrame];
 
     vkResetFences(m_device.device(), 1, &m_inFlightFences[m_currentFrame]);
 
     ASSERT_VK_SUCCESS(vkQueueSubmit(m_device.graphicsQueue(), 1, &submitInfo, m_inFlightFences[m_currentFrame]), "Failed to submit draw command buffer!");
+    m_gpuTimer.submitted(static_cast<uint32_t>(m_currentFrame));
 }
 
 void RenderingEngine::present()
 {
+    PROFILE_ZONE("RenderingEngine::present");
+
+    if (m_offscreen) {
+        presentOffscreen();
+        return;
+    }
+
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
@@ -274,11 +325,25 @@ void RenderingEngine::present()
     }
 
     m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
-    vkQueueWaitIdle(m_device.presentQueue());
+
+    {
+        PROFILE_ZONE("vkQueueWaitIdle");
+        vkQueueWaitIdle(m_device.presentQueue());
+    }
 
 resizeLoop:
-    vkWaitForFences(m_device.device(), 1, &m_inFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
-    result = vkAcquireNextImageKHR(m_device.device(), m_swapChain->swapChain(), UINT64_MAX, m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &m_imageIndex);
+    {
+        PROFILE_ZONE("vkWaitForFences");
+        vkWaitForFences(m_device.device(), 1, &m_inFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
+    }
+
+    // this slot's previous frame is done, its timestamps can be read without waiting
+    m_gpuTimer.collect(static_cast<uint32_t>(m_currentFrame));
+
+    {
+        PROFILE_ZONE("vkAcquireNextImageKHR");
+        result = vkAcquireNextImageKHR(m_device.device(), m_swapChain->swapChain(), UINT64_MAX, m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &m_imageIndex);
+    }
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         resize();
@@ -290,8 +355,50 @@ resizeLoop:
 
     // Check if a previous frame is using this image (i.e. there is its fence to wait on)
     if (m_imagesInFlight[m_imageIndex] != VK_NULL_HANDLE) {
+        PROFILE_ZONE("vkWaitForFences");
         vkWaitForFences(m_device.device(), 1, &m_imagesInFlight[m_imageIndex], VK_TRUE, UINT64_MAX);
     }
     // Mark the image as now being in use by this frame
     m_imagesInFlight[m_imageIndex] = m_inFlightFences[m_currentFrame];
 }
+
+void RenderingEngine::presentOffscreen()
+{
+    // paced like the windowed path so headless timings compare with it
+    m_presentedImage = m_imageIndex;
+    m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+
+    {
+        PROFILE_ZONE("vkQueueWaitIdle");
+        vkQueueWaitIdle(m_device.graphicsQueue());
+    }
+
+    {
+        PROFILE_ZONE("vkWaitForFences");
+        vkWaitForFences(m_device.device(), 1, &m_inFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
+    }
+
+    m_gpuTimer.collect(static_cast<uint32_t>(m_currentFrame));
+    m_imageIndex = static_cast<uint32_t>(m_currentFrame);
+}
+
+void RenderingEngine::finish()
+{
+    vkDeviceWaitIdle(m_device.device());
+    m_gpuTimer.collectAll();
+}
+
+bool RenderingEngine::saveFrame(const std::string& path) const
+{
+    if (!m_offscreen) {
+        spdlog::error("Can't save {}, only headless frames can be saved.", path);
+        return false;
+    }
+
+    if (m_presentedImage == static_cast<uint32_t>(-1)) {
+        spdlog::error("Can't save {}, no frame was presented yet.", path);
+        return false;
+    }
+
+    return m_offscreen->save(m_presentedImage, path);
+}
@@ -16,33 +16,52 @@
 
 #pragma once
 
+#include <string>
 #include <vector>
 
 #include "Pipeline.hpp"
 #include "Mesh.hpp"
 #include "Descriptors.hpp"
+#include "GpuTimer.hpp"
+#include "OffscreenTarget.hpp"
+#include "RenderSnapshot.hpp"
 
 
 #include "../ecs/ECSSystem.hpp"
-struct CameraInfo
-{
-    glm::mat4 m_viewProjection;
-};
+#include "../jobs/JobSystem.hpp"
+
+class Window;
 
 class RenderingEngine
 {
     static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
 
   public:
-    RenderingEngine(const VkSurfaceKHR& surface, Device& device);
+    // a headless window gets frames rendered into offscreen images of its size, present() only
+    // advances to the next of them then
+    RenderingEngine(const Window& window, Device& device, JobSystem& jobs);
     ~RenderingEngine();
 
-    void render();
+    // Only touches the snapshot and Vulkan objects, so once the engine runs both of these can be
+    // called from a render thread other than the one that created it.
+    void render(const RenderSnapshot& snapshot);
     void present();
 
+    // waits until the GPU is done with every frame and collects their timings
+    void finish();
+
+    // headless only, writes the last presented frame as a PNG. call finish() first.
+    bool saveFrame(const std::string& path) const;
+
+    // GPU time of every pass, a few frames behind
+    [[nodiscard]] constexpr const GpuTimer& gpuTimer() const { return m_gpuTimer; }
+    [[nodiscard]] constexpr GpuTimer& gpuTimer() { return m_gpuTimer; }
+
   private:
     const Device& m_device;
     std::unique_ptr<SwapChain> m_swapChain;
+    std::unique_ptr<OffscreenTarget> m_offscreen;// instead of the swap chain when headless
+    GpuTimer m_gpuTimer;
 
     std::unique_ptr<BasicRasterPipeline> m_basicRasterPipeline;
 
@@ -52,6 +71,7 @@ class RenderingEngine
     std::vector<VkFence> m_imagesInFlight;
     uint32_t m_imageIndex;
     size_t m_currentFrame = 0;
+    uint32_t m_presentedImage = static_cast<uint32_t>(-1);// headless, for saveFrame()
 
     bool m_commandBuffersInvalidated = false;
     uint32_t m_startingCBUpdateIndex = static_cast<uint32_t>(-1);
@@ -66,10 +86,13 @@ class RenderingEngine
 
     std::unique_ptr<Mesh> m_monkey;
 
+    [[nodiscard]] inline const VkExtent2D& extent() const { return m_swapChain ? m_swapChain->extent() : m_offscreen->extent(); }
+
     void createFramebuffers();
     void destroyFramebuffers();
 
     void resize();
+    void presentOffscreen();
     void recordCommandBuffer(uint32_t cbfIndex);
 
     constexpr void invalidateCommandBuffers()
@@ -80,17 +103,18 @@ class RenderingEngine
 
         m_commandBuffersInvalidated = true;
     }
-
-    friend class CameraScraper;
 };
 
+// copies the camera into the snapshot being filled
 class CameraScraper : public ECSSystem
 {
   public:
-    CameraScraper(RenderingEngine& parentEngine);
+    CameraScraper(RenderSnapshots& snapshots);
 
-    virtual void update(float delta, Entity_t entity) override;
+    [[nodiscard]] virtual const char* name() const override { return "CameraScraper"; }
+    virtual void updateChunk(float delta, const Archetype& archetype, const ArchetypeChunk& chunk) override;
+    virtual void update([[maybe_unused]] float delta, [[maybe_unused]] Entity_t entity) override final {}// never called, see updateChunk
 
   private:
-    RenderingEngine& m_parentEngine;
+    RenderSnapshots& m_snapshots;
 };
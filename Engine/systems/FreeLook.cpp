@@ -16,46 +16,38 @@
 
 #include "FreeLook.hpp"
 
-#include "../components/Transform.hpp"
-#include "../components/Camera.hpp"
-
 #include <glm/glm.hpp>
 
-static constexpr int MOUSE_LEFT = 0;
-static constexpr int MOUSE_RIGHT = 1;
-
 static glm::vec3 UP{ 0, 1, 0 };
 static glm::vec3 RIGHT{ 1, 0, 0 };
 
-FreeLook::FreeLook(Window& window, float sensitivity, bool invertY) : m_inputContext(window), m_locked(false), m_sensitivity(sensitivity), m_invertY(invertY)
+FreeLook::FreeLook(Input& input, float sensitivity, bool invertY) : m_input(input), m_locked(false), m_sensitivity(sensitivity), m_invertY(invertY)
 {
-    addComponentType(Transform::ID);
-    addComponentType(Camera::ID);
+    requireMainThread();// moves the glfw cursor
 }
 
-void FreeLook::update(float delta, Entity_t entity)
+void FreeLook::beginUpdate(float delta)
 {
     using vec2d = glm::dvec2;
 
-    Transform& transform = *get<Transform>(entity);
+    m_rotation = vec2d{ 0 };
 
-    if (glfwGetMouseButton(m_inputContext.glfwWindowPtr(), MOUSE_LEFT) && !m_locked) {
-        glfwSetInputMode(m_inputContext.glfwWindowPtr(), GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
+    if (m_input.buttonDown(MouseButton::LEFT) && !m_locked) {
+        m_input.setCursorHidden(true);
         center();
         m_locked = true;
     }
 
-    if (glfwGetMouseButton(m_inputContext.glfwWindowPtr(), MOUSE_RIGHT) && m_locked) {
-        glfwSetInputMode(m_inputContext.glfwWindowPtr(), GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+    if (m_input.buttonDown(MouseButton::RIGHT) && m_locked) {
+        m_input.setCursorHidden(false);
         m_locked = false;
     }
 
     if (m_locked) {
-        vec2d diff;
-        glfwGetCursorPos(m_inputContext.glfwWindowPtr(), &diff.x, &diff.y);
+        vec2d diff = m_input.cursor();
 
         // normalize diff
-        diff *= vec2d{ 2.0 / static_cast<double>(m_inputContext.width()), 2.0 / static_cast<double>(m_inputContext.height()) };
+        diff *= vec2d{ 2.0 / static_cast<double>(m_input.width()), 2.0 / static_cast<double>(m_input.height()) };
 
         diff -= 1.0;
 
@@ -66,15 +58,26 @@ void FreeLook::update(float delta, Entity_t entity)
             diff.y *= -1;
         }
 
-        if (diff.x != 0) {
-            transform.m_orientation = glm::normalize(glm::angleAxis(static_cast<float>(diff.x), UP) * transform.m_orientation);
+        m_rotation = diff;
+        center();
+    }
+}
+
+bool FreeLook::needsUpdate() const
+{
+    return m_rotation.x != 0 || m_rotation.y != 0;
+}
+
+void FreeLook::updateBatch([[maybe_unused]] float delta, std::span<Transform> transforms, [[maybe_unused]] std::span<const Camera> cameras)
+{
+    for (Transform& transform : transforms) {
+        if (m_rotation.x != 0) {
+            transform.m_orientation = glm::normalize(glm::angleAxis(static_cast<float>(m_rotation.x), UP) * transform.m_orientation);
         }
 
-        if (diff.y != 0) {
+        if (m_rotation.y != 0) {
             glm::vec3 right = transform.m_orientation * RIGHT;
-            transform.m_orientation = glm::normalize(glm::angleAxis(static_cast<float>(diff.y), right) * transform.m_orientation);
+            transform.m_orientation = glm::normalize(glm::angleAxis(static_cast<float>(m_rotation.y), right) * transform.m_orientation);
         }
-
-        center();
     }
 }
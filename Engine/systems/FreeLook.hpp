@@ -16,26 +16,34 @@
 
 #pragma once
 
-#include "../ecs/ECSSystem.hpp"
-#include "../window.hpp"
+#include "../components/Camera.hpp"
+#include "../components/Transform.hpp"
+#include "../ecs/BatchSystem.hpp"
+#include "../input/Input.hpp"
 
-class FreeLook : public ECSSystem
+class FreeLook : public BatchSystem<Transform, const Camera>
 {
   public:
-    FreeLook(Window& window, float sensitivity = 50.0f, bool invertY = false);
+    FreeLook(Input& input, float sensitivity = 50.0f, bool invertY = false);
 
-    virtual void update(float delta, Entity_t entity) override;
+    [[nodiscard]] virtual const char* name() const override { return "FreeLook"; }
+    virtual void beginUpdate(float delta) override;
+    [[nodiscard]] virtual bool needsUpdate() const override;
+    virtual void updateBatch(float delta, std::span<Transform> transforms, std::span<const Camera> cameras) override;
 
   private:
-    Window& m_inputContext;
+    Input& m_input;
 
     bool m_locked;
     float m_sensitivity;
 
     bool m_invertY;
 
+    // rotation sampled once per update, applied to every entity
+    glm::dvec2 m_rotation{ 0 };
+
     inline void center()
     {
-        glfwSetCursorPos(m_inputContext.glfwWindowPtr(), static_cast<double>(m_inputContext.width()) / 2.0, static_cast<double>(m_inputContext.height()) / 2.0);
+        m_input.setCursor(glm::dvec2{ static_cast<double>(m_input.width()) / 2.0, static_cast<double>(m_input.height()) / 2.0 });
     }
 };
@@ -16,36 +16,44 @@
 
 #include "FreeMove.hpp"
 
-#include "../components/Transform.hpp"
-#include "../components/Camera.hpp"
-#include <GLFW/glfw3.h>
-
 static glm::vec3 RIGHT{ 1, 0, 0 };
 static glm::vec3 FORWARD{ 0, 0, 1 };
 
-FreeMove::FreeMove(Window& window, float speed) : m_inputContext(window), m_speed(speed)
+FreeMove::FreeMove(Input& input, float speed) : m_input(input), m_speed(speed)
 {
-    addComponentType(Transform::ID);
-    addComponentType(Camera::ID);
 }
 
-void FreeMove::update(float delta, Entity_t entity)
+void FreeMove::beginUpdate([[maybe_unused]] float delta)
 {
-    Transform& transform = *get<Transform>(entity);
+    m_direction = glm::vec3{ 0 };
+
+    if (m_input.keyDown(Key::W)) {
+        m_direction -= FORWARD;
+    }
 
-    if (glfwGetKey(m_inputContext.glfwWindowPtr(), GLFW_KEY_W) == GLFW_PRESS) {
-        transform.m_position += glm::normalize(transform.m_orientation * -FORWARD) * delta * m_speed;
+    if (m_input.keyDown(Key::S)) {
+        m_direction += FORWARD;
     }
 
-    if (glfwGetKey(m_inputContext.glfwWindowPtr(), GLFW_KEY_S) == GLFW_PRESS) {
-        transform.m_position += glm::normalize(transform.m_orientation * FORWARD) * delta * m_speed;
+    if (m_input.keyDown(Key::A)) {
+        m_direction -= RIGHT;
     }
 
-    if (glfwGetKey(m_inputContext.glfwWindowPtr(), GLFW_KEY_A) == GLFW_PRESS) {
-        transform.m_position += glm::normalize(transform.m_orientation * -RIGHT) * delta * m_speed;
+    if (m_input.keyDown(Key::D)) {
+        m_direction += RIGHT;
     }
+}
+
+bool FreeMove::needsUpdate() const
+{
+    return !(m_direction == glm::vec3{ 0 });// no key held, leave the transforms unchanged
+}
+
+void FreeMove::updateBatch(float delta, std::span<Transform> transforms, [[maybe_unused]] std::span<const Camera> cameras)
+{
+    glm::vec3 step = m_direction * (delta * m_speed);
 
-    if (glfwGetKey(m_inputContext.glfwWindowPtr(), GLFW_KEY_D) == GLFW_PRESS) {
-        transform.m_position += glm::normalize(transform.m_orientation * RIGHT) * delta * m_speed;
+    for (Transform& transform : transforms) {
+        transform.m_position += transform.m_orientation * step;
     }
 }
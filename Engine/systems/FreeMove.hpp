@@ -16,18 +16,26 @@
 
 #pragma once
 
-#include "../ecs/ECSSystem.hpp"
-#include "../window.hpp"
+#include "../components/Camera.hpp"
+#include "../components/Transform.hpp"
+#include "../ecs/BatchSystem.hpp"
+#include "../input/Input.hpp"
 
-class FreeMove : public ECSSystem
+class FreeMove : public BatchSystem<Transform, const Camera>
 {
   public:
-    FreeMove(Window& window, float speed = 10.0f);
+    FreeMove(Input& input, float speed = 10.0f);
 
-    virtual void update(float delta, Entity_t entity) override;
+    [[nodiscard]] virtual const char* name() const override { return "FreeMove"; }
+    virtual void beginUpdate(float delta) override;
+    [[nodiscard]] virtual bool needsUpdate() const override;
+    virtual void updateBatch(float delta, std::span<Transform> transforms, std::span<const Camera> cameras) override;
 
   private:
-    Window& m_inputContext;
+    Input& m_input;
 
     float m_speed;
+
+    // local space direction of the pressed keys, sampled once per update
+    glm::vec3 m_direction{ 0 };
 };
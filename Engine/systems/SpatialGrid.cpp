@@ -0,0 +1,315 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "SpatialGrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+static float distance2(const glm::vec3& a, const glm::vec3& b)
+{
+    glm::vec3 d = a - b;
+    return d.x * d.x + d.y * d.y + d.z * d.z;
+}
+
+SpatialGrid::SpatialGrid(float cellSize) : m_cellSize(cellSize), m_inverseCellSize(1.0f / cellSize)
+{
+    addComponentTypes<const Transform>();
+}
+
+void SpatialGrid::beginUpdate([[maybe_unused]] float delta)
+{
+    if (m_departures == nullptr) {// nothing was placed before this
+        m_departures = &scene().trackDepartures(*scene().systemQuery(this));
+    }
+
+    // entities got removed or lost their transform, drop them. ones that got it back since
+    // sit in changed chunks and get placed again below.
+    for (Entity_t entity : *m_departures) {
+        if (entity.m_index < m_entries.size() && m_entries[entity.m_index].m_cell != NO_CELL && m_entries[entity.m_index].m_generation == entity.m_generation) {
+            remove(entity.m_index);
+        }
+    }
+
+    m_departures->clear();
+
+    for (const Archetype* archetype : query().m_archetypes) {
+        size_t column = static_cast<size_t>(archetype->columnIndex(Transform::ID));
+
+        for (const ArchetypeChunk& chunk : archetype->chunks()) {
+            if (!changed<Transform>(*archetype, chunk)) {
+                continue;
+            }
+
+            const uint32_t* entities = archetype->entities(chunk);
+            const auto* transforms = static_cast<const Transform*>(static_cast<void*>(archetype->column(chunk, column)));
+
+            for (uint32_t row = 0; row < chunk.m_count; row++) {
+                place(scene().handle(entities[row]), transforms[row].m_position);
+            }
+        }
+    }
+}
+
+SpatialGrid::Coord SpatialGrid::coord(const glm::vec3& position) const
+{
+    return Coord{ static_cast<int32_t>(std::floor(position.x * m_inverseCellSize)),
+        static_cast<int32_t>(std::floor(position.y * m_inverseCellSize)),
+        static_cast<int32_t>(std::floor(position.z * m_inverseCellSize)) };
+}
+
+uint64_t SpatialGrid::key(const Coord& coord)
+{
+    // 21 bits per axis, far away cells may share a bucket which only costs extra distance tests
+    constexpr uint64_t MASK = (1u << 21) - 1;
+    return (static_cast<uint64_t>(static_cast<uint32_t>(coord.x)) & MASK) << 42
+           | (static_cast<uint64_t>(static_cast<uint32_t>(coord.y)) & MASK) << 21
+           | (static_cast<uint64_t>(static_cast<uint32_t>(coord.z)) & MASK);
+}
+
+const SpatialGrid::Cell* SpatialGrid::findCell(const Coord& coord) const
+{
+    auto it = m_cellLookup.find(key(coord));
+    return it != m_cellLookup.end() ? &m_cells[it->second] : nullptr;
+}
+
+void SpatialGrid::place(Entity_t entity, const glm::vec3& position)
+{
+    if (entity.m_index >= m_entries.size()) {
+        m_entries.resize(entity.m_index + 1);
+    }
+
+    Coord cellCoord = coord(position);
+    uint64_t cellKey = key(cellCoord);
+    Entry& entry = m_entries[entity.m_index];
+
+    if (entry.m_cell != NO_CELL) {
+        Cell& cell = m_cells[entry.m_cell];
+
+        if (cell.m_key == cellKey && entry.m_generation == entity.m_generation) {// moved within its cell
+            cell.m_positions[entry.m_slot] = position;
+            return;
+        }
+
+        remove(entity.m_index);
+    }
+
+    auto [it, inserted] = m_cellLookup.try_emplace(cellKey, static_cast<uint32_t>(m_cells.size()));
+    if (inserted) {
+        m_cells.push_back(Cell{ cellKey, {}, {} });
+    }
+
+    Cell& cell = m_cells[it->second];
+    entry = Entry{ it->second, static_cast<uint32_t>(cell.m_entities.size()), entity.m_generation };
+    cell.m_entities.push_back(entity);
+    cell.m_positions.push_back(position);
+    m_size++;
+
+    m_min = Coord{ std::min(m_min.x, cellCoord.x), std::min(m_min.y, cellCoord.y), std::min(m_min.z, cellCoord.z) };
+    m_max = Coord{ std::max(m_max.x, cellCoord.x), std::max(m_max.y, cellCoord.y), std::max(m_max.z, cellCoord.z) };
+}
+
+void SpatialGrid::remove(uint32_t entityIndex)
+{
+    Entry& entry = m_entries[entityIndex];
+    Cell& cell = m_cells[entry.m_cell];
+
+    // swap with the cell's last entity
+    Entity_t last = cell.m_entities.back();
+    cell.m_entities[entry.m_slot] = last;
+    cell.m_positions[entry.m_slot] = cell.m_positions.back();
+    m_entries[last.m_index].m_slot = entry.m_slot;
+
+    cell.m_entities.pop_back();
+    cell.m_positions.pop_back();
+
+    entry.m_cell = NO_CELL;
+    m_size--;
+}
+
+template<typename Function>
+void SpatialGrid::forEachCell(Coord min, Coord max, Function&& function) const
+{
+    min = Coord{ std::max(min.x, m_min.x), std::max(min.y, m_min.y), std::max(min.z, m_min.z) };
+    max = Coord{ std::min(max.x, m_max.x), std::min(max.y, m_max.y), std::min(max.z, m_max.z) };
+
+    if (min.x > max.x || min.y > max.y || min.z > max.z) {
+        return;
+    }
+
+    uint64_t volume = static_cast<uint64_t>(static_cast<int64_t>(max.x) - min.x + 1)
+                      * static_cast<uint64_t>(static_cast<int64_t>(max.y) - min.y + 1)
+                      * static_cast<uint64_t>(static_cast<int64_t>(max.z) - min.z + 1);
+
+    // a range spanning more cells than exist is cheaper to answer by walking every cell
+    if (volume > m_cells.size()) {
+        for (const Cell& cell : m_cells) {
+            function(cell);
+        }
+        return;
+    }
+
+    for (int32_t x = min.x; x <= max.x; x++) {
+        for (int32_t y = min.y; y <= max.y; y++) {
+            for (int32_t z = min.z; z <= max.z; z++) {
+                if (const Cell* cell = findCell(Coord{ x, y, z })) {
+                    function(*cell);
+                }
+            }
+        }
+    }
+}
+
+void SpatialGrid::queryRadius(const RadiusQuery& query, std::vector<Entity_t>& out) const
+{
+    glm::vec3 extent{ query.m_radius, query.m_radius, query.m_radius };
+    float radius2 = query.m_radius * query.m_radius;
+
+    forEachCell(coord(query.m_center - extent), coord(query.m_center + extent), [&](const Cell& cell) {
+        for (size_t i = 0; i < cell.m_positions.size(); i++) {
+            if (distance2(cell.m_positions[i], query.m_center) <= radius2) {
+                out.push_back(cell.m_entities[i]);
+            }
+        }
+    });
+}
+
+void SpatialGrid::queryBox(const BoxQuery& query, std::vector<Entity_t>& out) const
+{
+    forEachCell(coord(query.m_min), coord(query.m_max), [&](const Cell& cell) {
+        for (size_t i = 0; i < cell.m_positions.size(); i++) {
+            const glm::vec3& p = cell.m_positions[i];
+
+            if (p.x >= query.m_min.x && p.y >= query.m_min.y && p.z >= query.m_min.z && p.x <= query.m_max.x && p.y <= query.m_max.y && p.z <= query.m_max.z) {
+                out.push_back(cell.m_entities[i]);
+            }
+        }
+    });
+}
+
+void SpatialGrid::queryNearest(const NearestQuery& query, std::vector<Entity_t>& out) const
+{
+    if (query.m_count == 0 || m_size == 0) {
+        return;
+    }
+
+    // max heap of the best candidates so far, the worst one on top
+    std::vector<std::pair<float, Entity_t>> best;
+    auto worse = [](const std::pair<float, Entity_t>& a, const std::pair<float, Entity_t>& b) { return a.first < b.first; };
+    float maxDistance2 = query.m_maxDistance * query.m_maxDistance;
+
+    auto consider = [&](const Cell& cell) {
+        for (size_t i = 0; i < cell.m_positions.size(); i++) {
+            float d2 = distance2(cell.m_positions[i], query.m_point);
+
+            if (d2 > maxDistance2 || (best.size() == query.m_count && d2 >= best.front().first)) {
+                continue;
+            }
+
+            if (best.size() == query.m_count) {
+                std::pop_heap(best.begin(), best.end(), worse);
+                best.pop_back();
+            }
+
+            best.emplace_back(d2, cell.m_entities[i]);
+            std::push_heap(best.begin(), best.end(), worse);
+        }
+    };
+
+    // Search shells of cells around the point's cell. Anything not searched yet lies outside the
+    // cube of the previous shells, so once the heap is full and its worst is closer than that
+    // cube's nearest face we're done.
+    Coord center = coord(query.m_point);
+    int64_t maxRing = 0;
+    maxRing = std::max<int64_t>(maxRing, static_cast<int64_t>(center.x) - m_min.x);
+    maxRing = std::max<int64_t>(maxRing, static_cast<int64_t>(m_max.x) - center.x);
+    maxRing = std::max<int64_t>(maxRing, static_cast<int64_t>(center.y) - m_min.y);
+    maxRing = std::max<int64_t>(maxRing, static_cast<int64_t>(m_max.y) - center.y);
+    maxRing = std::max<int64_t>(maxRing, static_cast<int64_t>(center.z) - m_min.z);
+    maxRing = std::max<int64_t>(maxRing, static_cast<int64_t>(m_max.z) - center.z);
+
+    for (int32_t ring = 0; ring <= maxRing; ring++) {
+        float reach = 0.0f;// closest anything in this shell or beyond can be
+        if (ring > 0) {
+            glm::vec3 low = glm::vec3(static_cast<float>(center.x - ring + 1), static_cast<float>(center.y - ring + 1), static_cast<float>(center.z - ring + 1)) * m_cellSize;
+            glm::vec3 high = glm::vec3(static_cast<float>(center.x + ring), static_cast<float>(center.y + ring), static_cast<float>(center.z + ring)) * m_cellSize;
+            glm::vec3 toLow = query.m_point - low;
+            glm::vec3 toHigh = high - query.m_point;
+            reach = std::min({ toLow.x, toLow.y, toLow.z, toHigh.x, toHigh.y, toHigh.z });
+        }
+
+        if (reach * reach > maxDistance2 || (best.size() == query.m_count && best.front().first <= reach * reach)) {
+            break;
+        }
+
+        // once a shell has more cells than the grid, finish by walking every cell
+        uint64_t side = 2 * static_cast<uint64_t>(ring) + 1;
+        if (side * side * side > m_cells.size()) {
+            best.clear();
+            for (const Cell& cell : m_cells) {
+                consider(cell);
+            }
+            break;
+        }
+
+        for (int32_t dx = -ring; dx <= ring; dx++) {
+            for (int32_t dy = -ring; dy <= ring; dy++) {
+                bool edge = dx == -ring || dx == ring || dy == -ring || dy == ring;
+                int32_t step = edge || ring == 0 ? 1 : 2 * ring;// inside faces only need the two z caps
+
+                for (int32_t dz = -ring; dz <= ring; dz += step) {
+                    if (const Cell* cell = findCell(Coord{ center.x + dx, center.y + dy, center.z + dz })) {
+                        consider(*cell);
+                    }
+                }
+            }
+        }
+    }
+
+    std::sort_heap(best.begin(), best.end(), worse);
+    for (const auto& candidate : best) {
+        out.push_back(candidate.second);
+    }
+}
+
+template<typename Query, typename Function>
+void SpatialGrid::batch(JobSystem& jobs, std::span<const Query> queries, std::vector<std::vector<Entity_t>>& results, Function&& function)
+{
+    results.resize(queries.size());
+
+    jobs.parallelFor(0, static_cast<uint32_t>(queries.size()), QUERIES_PER_JOB, [&](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; i++) {
+            results[i].clear();
+            function(queries[i], results[i]);
+        }
+    });
+}
+
+void SpatialGrid::queryRadius(JobSystem& jobs, std::span<const RadiusQuery> queries, std::vector<std::vector<Entity_t>>& results) const
+{
+    batch(jobs, queries, results, [this](const RadiusQuery& query, std::vector<Entity_t>& out) { queryRadius(query, out); });
+}
+
+void SpatialGrid::queryBox(JobSystem& jobs, std::span<const BoxQuery> queries, std::vector<std::vector<Entity_t>>& results) const
+{
+    batch(jobs, queries, results, [this](const BoxQuery& query, std::vector<Entity_t>& out) { queryBox(query, out); });
+}
+
+void SpatialGrid::queryNearest(JobSystem& jobs, std::span<const NearestQuery> queries, std::vector<std::vector<Entity_t>>& results) const
+{
+    batch(jobs, queries, results, [this](const NearestQuery& query, std::vector<Entity_t>& out) { queryNearest(query, out); });
+}
@@ -0,0 +1,134 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "../components/Transform.hpp"
+#include "../ecs/ECSSystem.hpp"
+#include "../jobs/JobSystem.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Uniform hash grid over Transform::m_position. Only entities in chunks whose Transform changed
+// since the last run get re-bucketed; entities that got removed or lost their Transform come
+// from the scene's departure log, so neither costs anything per entity in the grid. Queries
+// are read only and may run on any number of threads at once, but never while the grid itself
+// runs, so it should be updated at a sync point through ECS::updateSystem (CoreEngine does
+// that after every update tick).
+class SpatialGrid : public ECSSystem
+{
+  public:
+    struct RadiusQuery
+    {
+        glm::vec3 m_center;
+        float m_radius;
+    };
+
+    struct BoxQuery
+    {
+        glm::vec3 m_min;
+        glm::vec3 m_max;
+    };
+
+    struct NearestQuery
+    {
+        glm::vec3 m_point;
+        uint32_t m_count;
+        float m_maxDistance = std::numeric_limits<float>::infinity();
+    };
+
+    static constexpr uint32_t QUERIES_PER_JOB = 256;
+
+    explicit SpatialGrid(float cellSize = 4.0f);
+
+    [[nodiscard]] virtual const char* name() const override { return "SpatialGrid"; }
+
+    // everything happens here, there's nothing left to do per chunk
+    virtual void beginUpdate(float delta) override;
+    [[nodiscard]] virtual bool needsUpdate() const override { return false; }
+    virtual void update([[maybe_unused]] float delta, [[maybe_unused]] Entity_t entity) override final {}
+
+    [[nodiscard]] constexpr size_t size() const { return m_size; }
+    [[nodiscard]] constexpr float cellSize() const { return m_cellSize; }
+
+    // the query functions append to out, in no particular order unless noted
+    void queryRadius(const RadiusQuery& query, std::vector<Entity_t>& out) const;
+    void queryBox(const BoxQuery& query, std::vector<Entity_t>& out) const;
+
+    // up to m_count closest entities within m_maxDistance, closest first
+    void queryNearest(const NearestQuery& query, std::vector<Entity_t>& out) const;
+
+    // batches spread over the job system, results[i] gets replaced by the result of queries[i]
+    void queryRadius(JobSystem& jobs, std::span<const RadiusQuery> queries, std::vector<std::vector<Entity_t>>& results) const;
+    void queryBox(JobSystem& jobs, std::span<const BoxQuery> queries, std::vector<std::vector<Entity_t>>& results) const;
+    void queryNearest(JobSystem& jobs, std::span<const NearestQuery> queries, std::vector<std::vector<Entity_t>>& results) const;
+
+  private:
+    static constexpr uint32_t NO_CELL = static_cast<uint32_t>(-1);
+
+    struct Coord
+    {
+        int32_t x, y, z;
+    };
+
+    // entities and positions of one cell, index i of both belongs to the same entity
+    struct Cell
+    {
+        uint64_t m_key;
+        std::vector<Entity_t> m_entities;
+        std::vector<glm::vec3> m_positions;
+    };
+
+    // where an entity index currently sits
+    struct Entry
+    {
+        uint32_t m_cell = NO_CELL;
+        uint32_t m_slot = 0;
+        uint32_t m_generation = 0;
+    };
+
+    float m_cellSize;
+    float m_inverseCellSize;
+
+    std::vector<Cell> m_cells;// never shrinks, emptied cells get refilled when something moves back in
+    std::unordered_map<uint64_t, uint32_t> m_cellLookup;
+    std::vector<Entry> m_entries;// by entity index
+    size_t m_size = 0;
+
+    // bounds of every cell that ever held something, queries never look outside
+    Coord m_min{ std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::max() };
+    Coord m_max{ std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::min() };
+
+    std::vector<Entity_t>* m_departures = nullptr;// see ECS::trackDepartures
+
+    [[nodiscard]] Coord coord(const glm::vec3& position) const;
+    [[nodiscard]] static uint64_t key(const Coord& coord);
+    [[nodiscard]] const Cell* findCell(const Coord& coord) const;
+
+    void place(Entity_t entity, const glm::vec3& position);
+    void remove(uint32_t entityIndex);
+
+    // calls function(cell) for every cell overlapping [min, max], clamped to the occupied bounds
+    template<typename Function>
+    void forEachCell(Coord min, Coord max, Function&& function) const;
+
+    template<typename Query, typename Function>
+    static void batch(JobSystem& jobs, std::span<const Query> queries, std::vector<std::vector<Entity_t>>& results, Function&& function);
+};
@@ -0,0 +1,275 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "TransformPropagation.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+TransformPropagation::TransformPropagation()
+{
+    addComponentTypes<const Transform, WorldTransform>();
+    addComponentType(Hierarchy::ID, OPTIONAL_BIT | READ_ONLY_BIT);
+}
+
+void TransformPropagation::beginUpdate([[maybe_unused]] float delta)
+{
+    bool rebuilt = false;
+
+    // structural changes elsewhere in the scene leave the order and the cached pointers alone
+    if (rowsChanged() || hierarchyChanged()) {
+        rebuild();
+        rebuilt = true;
+    }
+
+    // rows that got added or moved mark their whole chunk changed
+    for (size_t i = 0; i < m_chunks.size(); i++) {
+        const Archetype& archetype = *m_chunks[i].first;
+        m_chunkDirty[i] = changed<Transform>(archetype, archetype.chunks()[m_chunks[i].second]);
+    }
+
+    uint32_t batchCount = static_cast<uint32_t>(m_batches.size() - 1);
+
+    if (jobs() != nullptr && batchCount > 1) {
+        jobs()->parallelFor(0, batchCount, 1, [this](uint32_t first, uint32_t last) {
+            propagate(m_batches[first], m_batches[last]);
+        });
+    } else {
+        propagate(0, static_cast<uint32_t>(m_parents.size()));
+    }
+
+    if (rebuilt) {
+        std::fill(m_moved.begin(), m_moved.end(), 0);
+    }
+
+    // marking happens here rather than in propagate(), batches may share chunks
+    std::vector<uint8_t> written(m_chunks.size(), 0);
+    for (size_t i = 0; i < m_dirty.size(); i++) {
+        if (m_dirty[i] != 0) {
+            written[m_chunkSlots[i]] = 1;
+        }
+    }
+
+    for (size_t i = 0; i < m_chunks.size(); i++) {
+        if (written[i] != 0) {
+            const Archetype& archetype = *m_chunks[i].first;
+            archetype.markChanged(archetype.chunks()[m_chunks[i].second], static_cast<size_t>(archetype.columnIndex(WorldTransform::ID)), runTick());
+        }
+    }
+}
+
+bool TransformPropagation::rowsChanged() const
+{
+    const std::vector<Archetype*>& archetypes = query().m_archetypes;
+
+    if (archetypes.size() != m_rowsVersions.size()) {
+        return true;
+    }
+
+    for (size_t i = 0; i < archetypes.size(); i++) {
+        if (archetypes[i]->rowsVersion() != m_rowsVersions[i]) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool TransformPropagation::hierarchyChanged() const
+{
+    for (const Archetype* archetype : query().m_archetypes) {
+        if (archetype->columnIndex(Hierarchy::ID) < 0) {
+            continue;
+        }
+
+        for (const ArchetypeChunk& chunk : archetype->chunks()) {
+            if (changed<Hierarchy>(*archetype, chunk)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void TransformPropagation::rebuild()
+{
+    // gather every node in storage order
+    std::vector<int32_t> nodeOf(scene().slotCount(), -1);
+    std::vector<uint32_t> entityOf;
+    std::vector<const Transform*> locals;
+    std::vector<WorldTransform*> worldTransforms;
+    std::vector<Entity_t> parentHandles;
+    std::vector<uint32_t> chunkSlots;
+
+    m_chunks.clear();
+    m_rowsVersions.clear();
+
+    for (const Archetype* archetype : query().m_archetypes) {
+        m_rowsVersions.push_back(archetype->rowsVersion());
+
+        size_t localColumn = static_cast<size_t>(archetype->columnIndex(Transform::ID));
+        size_t worldColumn = static_cast<size_t>(archetype->columnIndex(WorldTransform::ID));
+        int32_t hierarchyColumn = archetype->columnIndex(Hierarchy::ID);
+
+        for (uint32_t c = 0; c < archetype->chunks().size(); c++) {
+            const ArchetypeChunk& chunk = archetype->chunks()[c];
+            const uint32_t* entities = archetype->entities(chunk);
+            const auto* chunkLocals = static_cast<const Transform*>(static_cast<void*>(archetype->column(chunk, localColumn)));
+            auto* chunkWorlds = static_cast<WorldTransform*>(static_cast<void*>(archetype->column(chunk, worldColumn)));
+            const Hierarchy* chunkHierarchies = hierarchyColumn < 0 ? nullptr : static_cast<const Hierarchy*>(static_cast<void*>(archetype->column(chunk, static_cast<size_t>(hierarchyColumn))));
+
+            for (uint32_t row = 0; row < chunk.m_count; row++) {
+                nodeOf[entities[row]] = static_cast<int32_t>(locals.size());
+                entityOf.push_back(entities[row]);
+                locals.push_back(chunkLocals + row);
+                worldTransforms.push_back(chunkWorlds + row);
+                parentHandles.push_back(chunkHierarchies == nullptr ? NULL_ENTITY : chunkHierarchies[row].m_parent);
+                chunkSlots.push_back(static_cast<uint32_t>(m_chunks.size()));
+            }
+
+            m_chunks.emplace_back(archetype, c);
+        }
+    }
+
+    size_t count = locals.size();
+    m_chunkDirty.assign(m_chunks.size(), 0);
+
+    // children grouped per parent with a counting sort, a parent that's dead or has no
+    // transform makes the node a root
+    std::vector<int32_t> parentOf(count, -1);
+    std::vector<uint32_t> childStart(count + 1, 0);
+
+    for (size_t i = 0; i < count; i++) {
+        if (scene().isAlive(parentHandles[i])) {
+            parentOf[i] = nodeOf[parentHandles[i].m_index];
+        }
+
+        if (parentOf[i] >= 0) {
+            childStart[static_cast<size_t>(parentOf[i]) + 1]++;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        childStart[i + 1] += childStart[i];
+    }
+
+    std::vector<uint32_t> children(childStart[count]);
+    std::vector<uint32_t> fill(childStart.begin(), childStart.end() - 1);
+
+    for (size_t i = 0; i < count; i++) {
+        if (parentOf[i] >= 0) {
+            children[fill[static_cast<size_t>(parentOf[i])]++] = static_cast<uint32_t>(i);
+        }
+    }
+
+    // the previous order, to carry the cached matrices over
+    std::vector<int32_t> oldParents;
+    std::vector<uint32_t> oldEntities;
+    std::vector<glm::mat4> oldWorlds;
+    oldParents.swap(m_parents);
+    oldEntities.swap(m_entities);
+    oldWorlds.swap(m_worlds);
+
+    std::vector<int32_t> oldNodeOf(scene().slotCount(), -1);
+    for (size_t i = 0; i < oldEntities.size(); i++) {
+        if (oldEntities[i] < oldNodeOf.size()) {
+            oldNodeOf[oldEntities[i]] = static_cast<int32_t>(i);
+        }
+    }
+
+    // depth first from every root, nodes stuck in a parent cycle are never reached
+    m_chunkSlots.clear();
+    m_locals.clear();
+    m_worldTransforms.clear();
+    m_worlds.clear();
+    m_moved.clear();
+    m_batches.assign(1, 0);
+
+    std::vector<std::pair<uint32_t, int32_t>> stack;// node, parent position in the new order
+
+    for (size_t root = 0; root < count; root++) {
+        if (parentOf[root] >= 0) {
+            continue;
+        }
+
+        stack.emplace_back(static_cast<uint32_t>(root), -1);
+
+        while (!stack.empty()) {
+            auto [node, parent] = stack.back();
+            stack.pop_back();
+
+            int32_t position = static_cast<int32_t>(m_parents.size());
+
+            // a node that kept its parent entity also kept its world matrix, unless its own
+            // or an ancestor's Transform changed, which the chunk versions catch
+            int32_t oldNode = oldNodeOf[entityOf[node]];
+            int64_t parentEntity = parent < 0 ? -1 : static_cast<int64_t>(m_entities[static_cast<size_t>(parent)]);
+            int64_t oldParentEntity = -1;
+
+            if (oldNode >= 0 && oldParents[static_cast<size_t>(oldNode)] >= 0) {
+                oldParentEntity = oldEntities[static_cast<size_t>(oldParents[static_cast<size_t>(oldNode)])];
+            }
+
+            bool moved = oldNode < 0 || parentEntity != oldParentEntity;
+
+            m_parents.push_back(parent);
+            m_entities.push_back(entityOf[node]);
+            m_chunkSlots.push_back(chunkSlots[node]);
+            m_locals.push_back(locals[node]);
+            m_worldTransforms.push_back(worldTransforms[node]);
+            m_worlds.push_back(moved ? glm::mat4(1.0f) : oldWorlds[static_cast<size_t>(oldNode)]);
+            m_moved.push_back(moved ? 1 : 0);
+
+            for (uint32_t c = childStart[node + 1]; c > childStart[node]; c--) {
+                stack.emplace_back(children[c - 1], position);
+            }
+        }
+
+        if (m_parents.size() - m_batches.back() >= NODES_PER_BATCH) {
+            m_batches.push_back(static_cast<uint32_t>(m_parents.size()));
+        }
+    }
+
+    if (m_batches.back() != m_parents.size()) {
+        m_batches.push_back(static_cast<uint32_t>(m_parents.size()));
+    }
+
+    m_dirty.assign(m_parents.size(), 0);
+}
+
+void TransformPropagation::propagate(uint32_t first, uint32_t last)
+{
+    for (uint32_t i = first; i < last; i++) {
+        int32_t parent = m_parents[i];
+        bool dirty = m_chunkDirty[m_chunkSlots[i]] != 0 || m_moved[i] != 0 || (parent >= 0 && m_dirty[static_cast<size_t>(parent)] != 0);
+
+        m_dirty[i] = dirty;
+        if (!dirty) {
+            continue;
+        }
+
+        const Transform& local = *m_locals[i];
+        glm::mat4 world = glm::translate(glm::mat4(1.0f), local.m_position) * glm::toMat4(local.m_orientation) * glm::scale(glm::mat4(1.0f), local.m_scale);
+
+        if (parent >= 0) {
+            world = m_worlds[static_cast<size_t>(parent)] * world;
+        }
+
+        m_worlds[i] = world;
+        m_worldTransforms[i]->m_matrix = world;
+    }
+}
@@ -0,0 +1,72 @@
+/*
+   Copyright 2022 Eduardo Ibarra
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "../components/Hierarchy.hpp"
+#include "../components/Transform.hpp"
+#include "../components/WorldTransform.hpp"
+#include "../ecs/ECSSystem.hpp"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Keeps WorldTransform up to date for every entity with a Transform and a WorldTransform,
+// following Hierarchy parents. The nodes are kept in depth first order in flat arrays, so a
+// subtree is one contiguous range that always comes after its parent. Only nodes whose
+// Transform chunk changed, and everything below them, get recomputed. Root subtrees are
+// batched and propagated in parallel. The order is rebuilt when rows of matching archetypes
+// change or entities get reparented, nodes that kept their parent keep their cached matrix.
+class TransformPropagation : public ECSSystem
+{
+  public:
+    static constexpr uint32_t NODES_PER_BATCH = 1024;
+
+    TransformPropagation();
+
+    [[nodiscard]] virtual const char* name() const override { return "TransformPropagation"; }
+
+    // everything happens here, there's nothing left to do per chunk
+    virtual void beginUpdate(float delta) override;
+    [[nodiscard]] virtual bool needsUpdate() const override { return false; }
+    virtual void update([[maybe_unused]] float delta, [[maybe_unused]] Entity_t entity) override final {}
+
+  private:
+    std::vector<uint64_t> m_rowsVersions;// per query archetype as of the last rebuild
+
+    // one entry per matching archetype chunk
+    std::vector<std::pair<const Archetype*, uint32_t>> m_chunks;
+    std::vector<uint8_t> m_chunkDirty;
+
+    // one entry per node in depth first order, parents always come first
+    std::vector<int32_t> m_parents;// -1 for roots
+    std::vector<uint32_t> m_entities;
+    std::vector<uint32_t> m_chunkSlots;
+    std::vector<const Transform*> m_locals;
+    std::vector<WorldTransform*> m_worldTransforms;
+    std::vector<glm::mat4> m_worlds;
+    std::vector<uint8_t> m_dirty;
+    std::vector<uint8_t> m_moved;// new to the order or reparented by the last rebuild
+
+    // node ranges made of whole root subtrees, batches[i] to batches[i + 1]
+    std::vector<uint32_t> m_batches{ 0 };
+
+    [[nodiscard]] bool rowsChanged() const;
+    [[nodiscard]] bool hierarchyChanged() const;
+    void rebuild();
+    void propagate(uint32_t first, uint32_t last);
+};
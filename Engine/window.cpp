@@ -18,6 +18,7 @@
 
 #include "utils.hpp"
 #include <spdlog/spdlog.h>
+#include <vector>
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
     VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
@@ -66,29 +67,11 @@ void resizeCallback(GLFWwindow* window, int width, int height)
     win->m_height = static_cast<uint32_t>(height);
 }
 
-Window::Window(uint32_t width, uint32_t height, const char* title) : m_width{ width }, m_height{ height }
+static void createInstance(const char* name, std::vector<const char*> extensions, VkInstance& context, VkDebugUtilsMessengerEXT& debugMessanger)
 {
-    if (!glfwInit()) {
-        spdlog::critical("Could not initialize GLFW!");
-        return;
-    }
-
-    glfwDefaultWindowHints();
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-
-    m_window = glfwCreateWindow(static_cast<int>(width), static_cast<int>(height), title, nullptr, nullptr);
-
-    const GLFWvidmode* vm = glfwGetVideoMode(glfwGetPrimaryMonitor());
-    glfwSetWindowPos(m_window, (vm->width - static_cast<int>(width)) / 2, (vm->height - static_cast<int>(height)) / 2);
-    glfwShowWindow(m_window);
-
-    glfwSetWindowUserPointer(m_window, this);
-    glfwSetWindowSizeCallback(m_window, &resizeCallback);
-
-    //------- Vulkan Initialization --------
     VkApplicationInfo appInfo{};
     appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-    appInfo.pApplicationName = title;
+    appInfo.pApplicationName = name;
     appInfo.applicationVersion = VK_API_VERSION_1_3;
     appInfo.pEngineName = "Simple Vk Engine";
     appInfo.engineVersion = VK_API_VERSION_1_3;
@@ -98,12 +81,6 @@ Window::Window(uint32_t width, uint32_t height, const char* title) : m_width{ wi
     instInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     instInfo.pApplicationInfo = &appInfo;
 
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
-
     VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
     debugCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
     debugCreateInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
@@ -125,13 +102,46 @@ Window::Window(uint32_t width, uint32_t height, const char* title) : m_width{ wi
     instInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
     instInfo.ppEnabledExtensionNames = extensions.data();
 
-    ASSERT_VK_SUCCESS(vkCreateInstance(&instInfo, nullptr, &m_context), "Failed to create VkInstance");
+    ASSERT_VK_SUCCESS(vkCreateInstance(&instInfo, nullptr, &context), "Failed to create VkInstance");
+
+    setupValidationLayers(context, debugCreateInfo, debugMessanger);
+}
+
+Window::Window(uint32_t width, uint32_t height, const char* title) : m_width{ width }, m_height{ height }
+{
+    if (!glfwInit()) {
+        spdlog::critical("Could not initialize GLFW!");
+        return;
+    }
+
+    glfwDefaultWindowHints();
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+
+    m_window = glfwCreateWindow(static_cast<int>(width), static_cast<int>(height), title, nullptr, nullptr);
+
+    const GLFWvidmode* vm = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    glfwSetWindowPos(m_window, (vm->width - static_cast<int>(width)) / 2, (vm->height - static_cast<int>(height)) / 2);
+    glfwShowWindow(m_window);
+
+    glfwSetWindowUserPointer(m_window, this);
+    glfwSetWindowSizeCallback(m_window, &resizeCallback);
+
+    //------- Vulkan Initialization --------
+    uint32_t glfwExtensionCount = 0;
+    const char** glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-    setupValidationLayers(m_context, debugCreateInfo, m_debugMessanger);
+    createInstance(title, std::vector<const char*>(glfwExtensions, glfwExtensions + glfwExtensionCount), m_context, m_debugMessanger);
 
     ASSERT_VK_SUCCESS(glfwCreateWindowSurface(m_context, m_window, nullptr, &m_windowSurface), "failed to create window surface!");
 }
 
+Window::Window(uint32_t width, uint32_t height) : m_width{ width }, m_height{ height }
+{
+    // no surface extensions, works with display-less ICDs like lavapipe
+    createInstance("Vk App (headless)", {}, m_context, m_debugMessanger);
+}
+
 Window::~Window()
 {
 #ifndef NDEBUG
@@ -142,6 +152,11 @@ Window::~Window()
     }
 #endif
 
+    if (headless()) {
+        vkDestroyInstance(m_context, nullptr);
+        return;
+    }
+
     vkDestroySurfaceKHR(m_context, m_windowSurface, nullptr);
     vkDestroyInstance(m_context, nullptr);
 
@@ -151,5 +166,5 @@ Window::~Window()
 
 bool Window::shouldClose() const
 {
-    return glfwWindowShouldClose(m_window);
+    return !headless() && glfwWindowShouldClose(m_window);
 }
\ No newline at end of file
@@ -27,8 +27,15 @@ class Window
 {
   public:
     Window(uint32_t width, uint32_t height, const char* title);
+
+    // headless, a Vulkan instance but no window and no surface. rendering goes to offscreen
+    // images of this size.
+    Window(uint32_t width, uint32_t height);
+
     ~Window();
 
+    [[nodiscard]] constexpr bool headless() const { return m_window == nullptr; }
+
     bool shouldClose() const;
 
     [[nodiscard]] constexpr GLFWwindow* glfwWindowPtr() { return m_window; }
@@ -42,14 +49,14 @@ class Window
     [[nodiscard]] constexpr const VkSurfaceKHR& surface() const { return m_windowSurface; }
 
   private:
-    GLFWwindow* m_window;
+    GLFWwindow* m_window = nullptr;
 
     uint32_t m_width;
     uint32_t m_height;
 
-    VkInstance m_context;
-    VkDebugUtilsMessengerEXT m_debugMessanger;
-    VkSurfaceKHR m_windowSurface;
+    VkInstance m_context = VK_NULL_HANDLE;
+    VkDebugUtilsMessengerEXT m_debugMessanger = VK_NULL_HANDLE;
+    VkSurfaceKHR m_windowSurface = VK_NULL_HANDLE;
 
     friend void resizeCallback(GLFWwindow* window, int width, int height);
 };